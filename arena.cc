@@ -0,0 +1,50 @@
+#include <cstdlib>
+#include <vector>
+
+#include "arena.h"
+
+using namespace std;
+
+#define ARENA_FIRST_BLOCK (64 << 10)
+#define ARENA_MAX_BLOCK (4 << 20)
+
+Arena::Arena() : first_block_size(0), cur(NULL), end(NULL), block_size(ARENA_FIRST_BLOCK), allocated(0)
+{
+}
+
+Arena::~Arena()
+{
+    for (size_t i = 0; i < blocks.size(); i++)
+        free(blocks[i]);
+}
+
+void Arena::NewBlock(size_t min_bytes)
+{
+    size_t size = block_size;
+    while (size < min_bytes)
+        size *= 2;
+    if (block_size < ARENA_MAX_BLOCK)
+        block_size *= 2;
+
+    char* block = (char*) malloc(size);
+    if (block == NULL)
+        throw std::bad_alloc();
+    if (blocks.empty())
+        first_block_size = size;
+    blocks.push_back(block);
+    cur = block;
+    end = block + size;
+}
+
+void Arena::Reset()
+{
+    for (size_t i = 1; i < blocks.size(); i++)
+        free(blocks[i]);
+    if (!blocks.empty()) {
+        blocks.resize(1);
+        cur = blocks[0];
+        end = blocks[0] + first_block_size;
+    }
+    block_size = 2 * ARENA_FIRST_BLOCK;
+    allocated = 0;
+}
@@ -0,0 +1,85 @@
+#ifndef __ARENA__H__
+#define __ARENA__H__
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Arena is a bump allocator for everything the parser builds for one
+// program: AST nodes, the compiled polynomials and their arrays. Nothing
+// allocated from it is freed on its own. Reset() releases everything at
+// once and keeps the first block for the next program.
+class Arena {
+  public:
+    Arena();
+    ~Arena();
+
+    void* Allocate(size_t bytes, size_t align);
+    void Reset();
+    size_t BytesAllocated() const { return allocated; }
+
+    // T must not need its destructor run
+    template <class T> T* New()
+    {
+        return new (Allocate(sizeof(T), alignof(T))) T();
+    }
+    template <class T> T* NewArray(size_t n)
+    {
+        T* p = (T*) Allocate(n * sizeof(T), alignof(T));
+        for (size_t i = 0; i < n; i++)
+            new (p + i) T();
+        return p;
+    }
+
+  private:
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    void NewBlock(size_t min_bytes);
+
+    std::vector<char*> blocks;
+    size_t first_block_size;
+    char* cur;
+    char* end;
+    size_t block_size;      // size of the next block, doubling up to a limit
+    size_t allocated;
+};
+
+inline void* Arena::Allocate(size_t bytes, size_t align)
+{
+    uintptr_t p = ((uintptr_t) cur + align - 1) & ~(uintptr_t) (align - 1);
+    if (cur == NULL || p + bytes > (uintptr_t) end) {
+        NewBlock(bytes + align);
+        p = ((uintptr_t) cur + align - 1) & ~(uintptr_t) (align - 1);
+    }
+    cur = (char*) (p + bytes);
+    allocated += bytes;
+    return (void*) p;
+}
+
+// ArenaAllocator lets standard containers take their storage from an Arena.
+// deallocate() does nothing; the memory comes back with Arena::Reset().
+template <class T>
+class ArenaAllocator {
+  public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(Arena& a) : arena(&a) {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return (T*) arena->Allocate(n * sizeof(T), alignof(T)); }
+    void deallocate(T*, size_t) {}
+
+    Arena* arena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif  //__ARENA__H__
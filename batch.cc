@@ -0,0 +1,203 @@
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include "batch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_X86 1
+#include <immintrin.h>
+#else
+#define BATCH_X86 0
+#endif
+
+using namespace std;
+
+// The kernels evaluate p over a table t laid out as in EvaluateCompiled(),
+// except that every entry is a column of BATCH_LANES values. The parameters
+// and constants must already be in t.
+
+static void EvaluateLanes(const CompiledPolynomial& p, unsigned* t)
+{
+    const int L = BATCH_LANES;
+    for (int s = 0; s < p.sum_count; s++) {
+        for (int i = p.power_begin[s]; i < p.power_begin[s+1]; i++) {
+            unsigned* dst = t + (p.param_count + i) * L;
+            const unsigned* base = t + p.power_base[i] * L;
+            const unsigned* previous = t + p.power_previous[i] * L;
+            for (int lane = 0; lane < L; lane++) {
+                unsigned b = base[lane], result = 1;
+                for (unsigned e = p.power_step[i]; e != 0; e >>= 1) {
+                    if (e & 1)
+                        result *= b;
+                    b *= b;
+                }
+                dst[lane] = result * previous[lane];
+            }
+        }
+
+        const int* step = p.steps + 4 * p.step_begin[s];
+        const int* end = p.steps + 4 * p.step_begin[s+1];
+        for (; step < end; step += 4) {
+            unsigned* dst = t + step[0] * L;
+            const unsigned* q = t + step[1] * L;
+            const unsigned* power = t + step[2] * L;
+            const unsigned* r = t + step[3] * L;
+            for (int lane = 0; lane < L; lane++)
+                dst[lane] = q[lane] * power[lane] + r[lane];
+        }
+    }
+}
+
+#if BATCH_X86
+
+// _mm_mullo_epi32 (pmulld) is SSE4.1; each column is two 4-lane vectors
+__attribute__((target("sse4.1")))
+static void EvaluateLanesSse41(const CompiledPolynomial& p, unsigned* t)
+{
+    const int L = BATCH_LANES;
+    for (int s = 0; s < p.sum_count; s++) {
+        for (int i = p.power_begin[s]; i < p.power_begin[s+1]; i++) {
+            for (int h = 0; h < L; h += 4) {
+                __m128i b = _mm_loadu_si128((const __m128i*) (t + p.power_base[i] * L + h));
+                __m128i result = _mm_set1_epi32(1);
+                for (unsigned e = p.power_step[i]; e != 0; e >>= 1) {
+                    if (e & 1)
+                        result = _mm_mullo_epi32(result, b);
+                    b = _mm_mullo_epi32(b, b);
+                }
+                __m128i previous = _mm_loadu_si128((const __m128i*) (t + p.power_previous[i] * L + h));
+                _mm_storeu_si128((__m128i*) (t + (p.param_count + i) * L + h), _mm_mullo_epi32(result, previous));
+            }
+        }
+
+        const int* step = p.steps + 4 * p.step_begin[s];
+        const int* end = p.steps + 4 * p.step_begin[s+1];
+        for (; step < end; step += 4) {
+            for (int h = 0; h < L; h += 4) {
+                __m128i q = _mm_loadu_si128((const __m128i*) (t + step[1] * L + h));
+                __m128i power = _mm_loadu_si128((const __m128i*) (t + step[2] * L + h));
+                __m128i r = _mm_loadu_si128((const __m128i*) (t + step[3] * L + h));
+                _mm_storeu_si128((__m128i*) (t + step[0] * L + h), _mm_add_epi32(_mm_mullo_epi32(q, power), r));
+            }
+        }
+    }
+}
+
+// one 8-lane vector per column
+__attribute__((target("avx2")))
+static void EvaluateLanesAvx2(const CompiledPolynomial& p, unsigned* t)
+{
+    const int L = BATCH_LANES;
+    for (int s = 0; s < p.sum_count; s++) {
+        for (int i = p.power_begin[s]; i < p.power_begin[s+1]; i++) {
+            __m256i b = _mm256_loadu_si256((const __m256i*) (t + p.power_base[i] * L));
+            __m256i result = _mm256_set1_epi32(1);
+            for (unsigned e = p.power_step[i]; e != 0; e >>= 1) {
+                if (e & 1)
+                    result = _mm256_mullo_epi32(result, b);
+                b = _mm256_mullo_epi32(b, b);
+            }
+            __m256i previous = _mm256_loadu_si256((const __m256i*) (t + p.power_previous[i] * L));
+            _mm256_storeu_si256((__m256i*) (t + (p.param_count + i) * L), _mm256_mullo_epi32(result, previous));
+        }
+
+        const int* step = p.steps + 4 * p.step_begin[s];
+        const int* end = p.steps + 4 * p.step_begin[s+1];
+        for (; step < end; step += 4) {
+            __m256i q = _mm256_loadu_si256((const __m256i*) (t + step[1] * L));
+            __m256i power = _mm256_loadu_si256((const __m256i*) (t + step[2] * L));
+            __m256i r = _mm256_loadu_si256((const __m256i*) (t + step[3] * L));
+            _mm256_storeu_si256((__m256i*) (t + step[0] * L), _mm256_add_epi32(_mm256_mullo_epi32(q, power), r));
+        }
+    }
+}
+
+#endif  // BATCH_X86
+
+BatchMachine::BatchMachine(const vector<const CompiledPolynomial*>& polys)
+    : polys(polys), kernel(EvaluateLanes), kernel_name("scalar")
+{
+#if BATCH_X86
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = EvaluateLanesAvx2;
+        kernel_name = "avx2";
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        kernel = EvaluateLanesSse41;
+        kernel_name = "sse4.1";
+    }
+#endif
+
+    // the constants of each table are filled in once, as in the VM
+    size_t size = 0;
+    for (size_t i = 0; i < polys.size(); i++) {
+        table.push_back(size);
+        size += (size_t) polys[i]->scratch_size * BATCH_LANES;
+    }
+    scratch.resize(size + 1);
+    for (size_t i = 0; i < polys.size(); i++) {
+        const CompiledPolynomial& p = *polys[i];
+        unsigned* constant = &scratch[table[i]] + (p.param_count + p.power_count) * BATCH_LANES;
+        for (int c = 0; c < p.constant_count; c++)
+            fill(constant + c * BATCH_LANES, constant + (c + 1) * BATCH_LANES, (unsigned) p.constants[c]);
+    }
+}
+
+void BatchMachine::Run(const Bytecode& bytecode, int slot_count, const vector<int>& records,
+                       int record_size, long record_count, OutputSink& out)
+{
+    const int L = BATCH_LANES;
+    vector<unsigned> mem((size_t) max(slot_count, 1) * L);
+    vector<unsigned> outputs;       // a column for each OUTPUT run in the block
+
+    for (long first = 0; first < record_count; first += L) {
+        int lanes = (int) min((long) L, record_count - first);
+        const int* record = records.data() + first * record_size;
+        int input = 0;              // inputs each record has read so far
+        fill(mem.begin(), mem.end(), 0u);
+        outputs.clear();
+
+        const int* pc = bytecode.Code();
+        while (*pc != OP_HALT) {
+            switch (*pc) {
+                case OP_INPUT: {
+                    unsigned* column = &mem[pc[1] * L];
+                    for (int lane = 0; lane < lanes; lane++)
+                        column[lane] = input < record_size ? record[lane * record_size + input] : 0;
+                    input++;
+                    pc += 2;
+                    break;
+                }
+                case OP_OUTPUT:
+                    outputs.insert(outputs.end(), &mem[pc[1] * L], &mem[pc[1] * L] + L);
+                    pc += 2;
+                    break;
+                case OP_CONST:
+                    fill(&mem[pc[1] * L], &mem[pc[1] * L] + L, (unsigned) pc[2]);
+                    pc += 3;
+                    break;
+                case OP_EVAL: {
+                    const CompiledPolynomial& p = *polys[pc[1]];
+                    unsigned* t = &scratch[table[pc[1]]];
+                    for (int i = 0; i < p.param_count; i++) {
+                        if (i < pc[3])
+                            memcpy(t + i * L, &mem[pc[4 + i] * L], L * sizeof(unsigned));
+                        else
+                            memset(t + i * L, 0, L * sizeof(unsigned));
+                    }
+                    kernel(p, t);
+                    memcpy(&mem[pc[2] * L], t + p.sum_result[p.sum_count - 1] * L, L * sizeof(unsigned));
+                    pc += 4 + pc[3];
+                    break;
+                }
+                default:
+                    return;
+            }
+        }
+
+        for (int lane = 0; lane < lanes; lane++) {
+            for (size_t o = lane; o < outputs.size(); o += L)
+                out << (int) outputs[o] << '\n';
+        }
+    }
+}
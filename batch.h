@@ -0,0 +1,42 @@
+#ifndef __BATCH__H__
+#define __BATCH__H__
+
+#include <vector>
+
+#include "poly.h"
+#include "vm.h"
+
+// records run side by side in one block, one per lane
+#define BATCH_LANES 8
+
+// BatchMachine runs one program over many independent input records. The
+// records are taken BATCH_LANES at a time and run in lockstep: memory holds
+// a column of BATCH_LANES values for every slot, and each instruction works
+// on a whole column, so polynomials are evaluated with vector multiplies
+// and adds over all lanes at once. The kernel is picked when the machine is
+// built from what the CPU supports: AVX2, then SSE4.1, then plain loops.
+class BatchMachine {
+  public:
+    explicit BatchMachine(const std::vector<const CompiledPolynomial*>& polys);
+
+    // Runs record_count records of record_size inputs each, stored one
+    // after another in records. Every record starts from zeroed memory, as
+    // a run of its own would, and the OUTPUT lines of record i all come
+    // before those of record i+1.
+    void Run(const Bytecode& bytecode, int slot_count, const std::vector<int>& records,
+             int record_size, long record_count, OutputSink& out);
+
+    // name of the kernel in use
+    const char* Kernel() const { return kernel_name; }
+
+  private:
+    typedef void (*LaneKernel)(const CompiledPolynomial& p, unsigned* t);
+
+    std::vector<const CompiledPolynomial*> polys;
+    std::vector<unsigned> scratch;      // the tables of all polynomials, BATCH_LANES wide
+    std::vector<size_t> table;
+    LaneKernel kernel;
+    const char* kernel_name;
+};
+
+#endif  //__BATCH__H__
@@ -0,0 +1,103 @@
+#!/bin/bash
+
+# Checks --batch and --batch-file against single runs. The output of a
+# batch must be the output of the program run once on each record in turn.
+# The records are taken from the INPUTS section, cut into pieces of as many
+# values as the program has INPUT statements, and from a file with one
+# record per line. Both forms have a record count that is not a multiple of
+# the lanes of BatchMachine and a short last record, and the file also has
+# blank lines and a record with values past the ones the program reads.
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+
+mkdir -p ./output
+
+# Writes the program with the values in $@ as its INPUTS section
+generate()
+{
+    echo "TASKS"
+    echo "    2"
+    echo "POLY"
+    echo "    F(x, y) = x^3 y - 4 x y^2 + 9;"
+    echo "    G(x) = x^2 + 3 x - 1;"
+    echo "EXECUTE"
+    echo "    INPUT a;"
+    echo "    INPUT b;"
+    echo "    INPUT c;"
+    echo "    w = F(a, b);"
+    echo "    OUTPUT w;"
+    echo "    z = G(F(c, a));"
+    echo "    OUTPUT z;"
+    echo "    OUTPUT c;"
+    echo "INPUTS"
+    echo "    $*"
+}
+
+# Single runs of the program, one per line of records read from stdin
+expected()
+{
+    while read -r record; do
+        [ -z "${record}" ] && continue
+        generate ${record} > ./output/batch_single.txt
+        ./a.out < ./output/batch_single.txt
+    done
+    rm -f ./output/batch_single.txt
+}
+
+# checks that the batch run with the options in $3.. prints $2 and reports
+# as many records as $2 has lines of three outputs
+check()
+{
+    all=$((all+1))
+    local name=$1 expected_file=$2
+    shift 2
+    ./a.out "$@" --stats < ./output/batch_program.txt > ./output/${name}.output 2> ./output/${name}.stats
+    local records=$(( $(wc -l < ${expected_file}) / 3 ))
+    if ! cmp -s ${expected_file} ./output/${name}.output; then
+        echo "${name}: batch output differs from single runs:"
+        echo "--------------------------------------------------------"
+        diff ${expected_file} ./output/${name}.output
+    elif ! grep -q "^ran ${records} records " ./output/${name}.stats; then
+        echo "${name}: expected ${records} records, --stats reported:"
+        cat ./output/${name}.stats
+    else
+        count=$((count+1))
+        echo "${name}: OK"
+    fi
+    rm -f ./output/${name}.output ./output/${name}.stats
+}
+
+# 21 records of 3 values from the INPUTS section, then one of 2. The values
+# are large enough that F and G wrap.
+values=()
+for ((i = 0; i < 65; i++)); do values+=($(( (i * 7919 + 13) % 4001 ))); done
+generate ${values[@]} > ./output/batch_program.txt
+for ((i = 0; i < 65; i += 3)); do echo ${values[@]:i:3}; done | expected > ./output/batch_inputs.expected
+check batch_inputs ./output/batch_inputs.expected --batch
+rm -f ./output/batch_inputs.expected
+
+# The same program with records from a file. Blank lines are skipped, a
+# short record reads 0 for its missing inputs, and values past the third on
+# a line are ignored.
+{
+    for ((i = 0; i < 30; i += 3)); do echo ${values[@]:i:3}; done
+    echo
+    echo "   "
+    echo "5 6 7 8 9"
+    for ((i = 30; i < 65; i += 3)); do echo ${values[@]:i:3}; done
+} > ./output/batch_records.txt
+sed 's/^\(\S*\s\+\S*\s\+\S*\).*/\1/' ./output/batch_records.txt | expected > ./output/batch_file.expected
+check batch_file ./output/batch_file.expected --batch-file ./output/batch_records.txt
+rm -f ./output/batch_file.expected ./output/batch_records.txt ./output/batch_program.txt
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
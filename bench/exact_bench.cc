@@ -0,0 +1,177 @@
+// Cost of overflow-checked evaluation against plain int.
+//
+//   g++ -O2 -I.. exact_bench.cc ../exact.cc ../number.cc ../bigint.cc ../vm.cc ../poly.cc ../arena.cc ../jit.cc ../memo.cc ../outsink.cc -o exact_bench
+//   ./exact_bench [records] [rounds]
+//
+// First times a loop of multiply-adds on int, which wraps, and on Number,
+// which checks every operation. Then runs the EXECUTE section of vm_bench
+// on VirtualMachine and on ExactMachine, once with small inputs, where
+// every value stays on the 64-bit fast path, and once with inputs near
+// 2^32, where the nested evaluations need 128 bits and more. Output goes
+// to an OutputSink on /dev/null. Rates are the best of rounds.
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <sys/time.h>
+#include <fcntl.h>
+
+#include "vm.h"
+#include "exact.h"
+
+using namespace std;
+
+static double Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// F(x, y) = x^2 + 3 y - 1
+static const int f_sum_begin[] = { 0, 3 };
+static const int f_coefficients[] = { 1, 3, -1 };
+static const int f_term_begin[] = { 0, 1, 2, 2 };
+static const int f_factor_slot[] = { 0, 1 };
+static const int f_factor_exponent[] = { 2, 1 };
+
+// G(x) = 2 x + 7
+static const int g_sum_begin[] = { 0, 2 };
+static const int g_coefficients[] = { 2, 7 };
+static const int g_term_begin[] = { 0, 1, 1 };
+static const int g_factor_slot[] = { 0 };
+static const int g_factor_exponent[] = { 1 };
+
+// A CompiledPolynomial over the given arrays, before BuildHornerProgram()
+static CompiledPolynomial MakePolynomial(int param_count, int term_count, int factor_count, const int* sum_begin,
+                                         const int* coefficients, const int* term_begin, const int* factor_slot,
+                                         const int* factor_exponent)
+{
+    CompiledPolynomial p = CompiledPolynomial();
+    p.param_count = param_count;
+    p.slot_count = param_count;
+    p.sum_count = 1;
+    p.term_count = term_count;
+    p.factor_count = factor_count;
+    p.sum_begin = sum_begin;
+    p.coefficients = coefficients;
+    p.term_begin = term_begin;
+    p.factor_slot = factor_slot;
+    p.factor_exponent = factor_exponent;
+    return p;
+}
+
+// The ExactPolynomial with the same layout as p
+static ExactPolynomial ToExact(const CompiledPolynomial& p, int factor_count)
+{
+    ExactPolynomial e;
+    e.param_count = p.param_count;
+    e.sum_count = p.sum_count;
+    e.sum_begin.assign(p.sum_begin, p.sum_begin + p.sum_count + 1);
+    e.coefficients.assign(p.coefficients, p.coefficients + p.term_count);
+    e.term_begin.assign(p.term_begin, p.term_begin + p.term_count + 1);
+    e.factor_slot.assign(p.factor_slot, p.factor_slot + factor_count);
+    e.factor_exponent.assign(p.factor_exponent, p.factor_exponent + factor_count);
+    return e;
+}
+
+// acc = 3 acc + i wraps int after about 20 steps, so acc restarts every
+// 16 to keep the Number loop on its fast path as well
+template <typename T>
+static double MultiplyAddRate(long n, int rounds, T& result)
+{
+    double best = 0;
+    for (int r = 0; r < rounds; r++) {
+        double start = Now();
+        T acc = 0;
+        for (long i = 0; i < n; i++) {
+            if ((i & 15) == 0)
+                acc = T(i & 1023);
+            acc = acc * T(3) + T(i & 1023);
+        }
+        double rate = n / (Now() - start);
+        if (rate > best)
+            best = rate;
+        result = acc;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    long records = argc > 1 ? atol(argv[1]) : 1000000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+
+    int int_result = 0;
+    Number number_result;
+    double int_rate = MultiplyAddRate(records * 10, rounds, int_result);
+    double number_rate = MultiplyAddRate(records * 10, rounds, number_result);
+    cout << "multiply-add: int " << int_rate / 1e6 << " M/s, Number " << number_rate / 1e6
+         << " M/s (last results " << int_result << ", " << number_result.ToString() << ")" << endl;
+
+    CompiledPolynomial f = MakePolynomial(2, 3, 2, f_sum_begin, f_coefficients, f_term_begin, f_factor_slot,
+                                          f_factor_exponent);
+    CompiledPolynomial g = MakePolynomial(1, 2, 1, g_sum_begin, g_coefficients, g_term_begin, g_factor_slot,
+                                          g_factor_exponent);
+    Arena arena;
+    BuildHornerProgram(f, arena);
+    BuildHornerProgram(g, arena);
+    vector<const CompiledPolynomial*> polys;
+    polys.push_back(&f);
+    polys.push_back(&g);
+
+    ExactPolynomial ef = ToExact(f, 2), eg = ToExact(g, 1);
+    vector<const ExactPolynomial*> exact_polys;
+    exact_polys.push_back(&ef);
+    exact_polys.push_back(&eg);
+
+    // slots: 0 a, 1 b, 2 literal, 3 t, 4 w
+    Bytecode code;
+    vector<int> args(2);
+    for (long i = 0; i < records; i++) {
+        code.Input(0);
+        code.Input(1);
+        args[0] = 0; args[1] = 1;
+        code.Eval(0, 3, args);
+        code.Const(2, 5);
+        args[0] = 3; args[1] = 2;
+        code.Eval(0, 4, args);
+        args.resize(1);
+        args[0] = 4;
+        code.Eval(1, 4, args);
+        args.resize(2);
+        code.Output(4);
+    }
+    code.Halt();
+
+    OutputSink null_out(open("/dev/null", O_WRONLY));
+    for (int large = 0; large < 2; large++) {
+        vector<int> inputs;
+        for (long i = 0; i < records; i++) {
+            inputs.push_back(large ? -1 - i : i & 1023);
+            inputs.push_back(large ? -1 - (i ^ 0x5555) : (i ^ 0x5555) & 1023);
+        }
+
+        VirtualMachine vm(polys);
+        vector<int> mem(5);
+        ExactMachine exact(exact_polys);
+        double vm_best = 0, exact_best = 0;
+        for (int r = 0; r < rounds; r++) {
+            double start = Now();
+            vm.Run(code, mem.data(), inputs, null_out);
+            double rate = code.InstructionCount() / (Now() - start);
+            if (rate > vm_best)
+                vm_best = rate;
+
+            start = Now();
+            exact.Run(code, mem.size(), inputs, null_out);
+            rate = code.InstructionCount() / (Now() - start);
+            if (rate > exact_best)
+                exact_best = rate;
+        }
+        cout << (large ? "large inputs: " : "small inputs: ") << "int " << vm_best / 1e6
+             << " M instructions/s, exact " << exact_best / 1e6 << " M instructions/s ("
+             << exact.WideCount() << " wide, " << exact.BigCount() << " big results)" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Lexer throughput benchmark.
+//
+//   g++ -O2 -I.. lexer_bench.cc ../lexer.cc ../inputbuf.cc ../intern.cc ../charclass.cc -o lexer_bench
+//   ./lexer_bench program.txt
+//
+// Reports bytes/sec for splitting the file into runs with the scalar table
+// lookup (the "before" path) and with ClassRun() (SSE2, or AVX2 when built
+// with -mavx2), then for the full LexicalAnalyzer reading the file as stdin.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "lexer.h"
+#include "charclass.h"
+
+using namespace std;
+
+static double Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// Splits buf into space, number, identifier and single character tokens and
+// returns the number of tokens, so the work cannot be optimized away.
+template <size_t (*Run)(const char*, size_t, int, int*)>
+static long CountTokens(const vector<char>& buf, int& lines)
+{
+    const char* p = &buf[0];
+    size_t n = buf.size();
+    size_t i = 0;
+    long tokens = 0;
+
+    lines = 1;
+    while (i < n) {
+        i += Run(p + i, n - i, CC_SPACE, &lines);
+        if (i == n)
+            break;
+        if (IsDigitChar(p[i]))
+            i += Run(p + i, n - i, CC_DIGIT, NULL);
+        else if (IsAlphaChar(p[i]))
+            i += Run(p + i, n - i, CC_ALNUM, NULL);
+        else
+            i++;
+        tokens++;
+    }
+    return tokens;
+}
+
+static size_t ClassRunNoDefault(const char* p, size_t n, int cls, int* newlines)
+{
+    return ClassRun(p, n, cls, newlines);
+}
+
+template <size_t (*Run)(const char*, size_t, int, int*)>
+static void Measure(const char* label, const vector<char>& buf, int rounds)
+{
+    int lines = 0;
+    long tokens = 0;
+    double start = Now();
+    for (int r = 0; r < rounds; r++)
+        tokens += CountTokens<Run>(buf, lines);
+    double secs = Now() - start;
+    printf("%-10s %8.1f MB/s  (%ld tokens, %d lines)\n", label,
+           (double) buf.size() * rounds / secs / 1e6, tokens / rounds, lines);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s program.txt [rounds]\n", argv[0]);
+        return 1;
+    }
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    vector<char> buf;
+    char block[1 << 16];
+    size_t n;
+    while ((n = fread(block, 1, sizeof(block), f)) > 0)
+        buf.insert(buf.end(), block, block + n);
+    fclose(f);
+    if (buf.empty())
+        return 0;
+
+    Measure<ScalarRun>("scalar", buf, rounds);
+#if defined(CC_VECTOR_WIDTH)
+    Measure<ClassRunNoDefault>(CC_VECTOR_WIDTH == 32 ? "avx2" : "sse2", buf, rounds);
+#endif
+
+    // full lexer, reading the file through InputBuffer
+    int fd = open(argv[1], O_RDONLY);
+    if (fd < 0 || dup2(fd, 0) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    double start = Now();
+    LexicalAnalyzer lexer;
+    long tokens = 0;
+    while (lexer.GetToken().token_type != END_OF_FILE)
+        tokens++;
+    double secs = Now() - start;
+    printf("%-10s %8.1f MB/s  (%ld tokens)\n", "lexer",
+           (double) buf.size() / secs / 1e6, tokens);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// Bytecode VM throughput benchmark.
+//
+//   g++ -O2 -I.. vm_bench.cc ../vm.cc ../poly.cc ../arena.cc ../jit.cc ../memo.cc ../outsink.cc -o vm_bench
+//   g++ -O2 -I.. -DVM_SWITCH_DISPATCH vm_bench.cc ../vm.cc ../poly.cc ../arena.cc ../jit.cc ../memo.cc ../outsink.cc -o vm_bench_switch
+//   ./vm_bench [records] [rounds]
+//
+// Runs a generated EXECUTE section that reads two inputs per record, feeds
+// them through a few small polynomials, some with a literal argument, and
+// outputs the result, then reports instructions/sec. Output is formatted
+// into an OutputSink on /dev/null, so no terminal is involved. Building it
+// with and without -DVM_SWITCH_DISPATCH compares threaded and switch
+// dispatch.
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <sys/time.h>
+#include <fcntl.h>
+
+#include "vm.h"
+
+using namespace std;
+
+static double Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// F(x, y) = x^2 + 3 y - 1
+static const int f_sum_begin[] = { 0, 3 };
+static const int f_coefficients[] = { 1, 3, -1 };
+static const int f_term_begin[] = { 0, 1, 2, 2 };
+static const int f_factor_slot[] = { 0, 1 };
+static const int f_factor_exponent[] = { 2, 1 };
+
+// G(x) = 2 x + 7
+static const int g_sum_begin[] = { 0, 2 };
+static const int g_coefficients[] = { 2, 7 };
+static const int g_term_begin[] = { 0, 1, 1 };
+static const int g_factor_slot[] = { 0 };
+static const int g_factor_exponent[] = { 1 };
+
+// A CompiledPolynomial over the given arrays, before BuildHornerProgram()
+static CompiledPolynomial MakePolynomial(int param_count, int term_count, int factor_count, const int* sum_begin,
+                                         const int* coefficients, const int* term_begin, const int* factor_slot,
+                                         const int* factor_exponent)
+{
+    CompiledPolynomial p = CompiledPolynomial();
+    p.param_count = param_count;
+    p.slot_count = param_count;
+    p.sum_count = 1;
+    p.term_count = term_count;
+    p.factor_count = factor_count;
+    p.sum_begin = sum_begin;
+    p.coefficients = coefficients;
+    p.term_begin = term_begin;
+    p.factor_slot = factor_slot;
+    p.factor_exponent = factor_exponent;
+    return p;
+}
+
+int main(int argc, char* argv[])
+{
+    long records = argc > 1 ? atol(argv[1]) : 1000000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+
+    CompiledPolynomial f = MakePolynomial(2, 3, 2, f_sum_begin, f_coefficients, f_term_begin, f_factor_slot,
+                                          f_factor_exponent);
+    CompiledPolynomial g = MakePolynomial(1, 2, 1, g_sum_begin, g_coefficients, g_term_begin, g_factor_slot,
+                                          g_factor_exponent);
+    Arena arena;
+    BuildHornerProgram(f, arena);
+    BuildHornerProgram(g, arena);
+    vector<const CompiledPolynomial*> polys;
+    polys.push_back(&f);
+    polys.push_back(&g);
+
+    // slots: 0 a, 1 b, 2 literal, 3 t, 4 w
+    Bytecode code;
+    vector<int> args(2);
+    vector<int> inputs;
+    for (long i = 0; i < records; i++) {
+        code.Input(0);
+        code.Input(1);
+        args[0] = 0; args[1] = 1;
+        code.Eval(0, 3, args);
+        code.Const(2, 5);
+        args[0] = 3; args[1] = 2;
+        code.Eval(0, 4, args);
+        args.resize(1);
+        args[0] = 4;
+        code.Eval(1, 4, args);
+        args.resize(2);
+        code.Output(4);
+        inputs.push_back(i);
+        inputs.push_back(i ^ 0x5555);
+    }
+    code.Halt();
+
+    VirtualMachine vm(polys);
+    vector<int> mem(5);
+    OutputSink null_out(open("/dev/null", O_WRONLY));
+
+    double best = 0;
+    for (int r = 0; r < rounds; r++) {
+        double start = Now();
+        vm.Run(code, mem.data(), inputs, null_out);
+        double rate = code.InstructionCount() / (Now() - start);
+        if (rate > best)
+            best = rate;
+    }
+#ifdef VM_SWITCH_DISPATCH
+    const char* dispatch = "switch";
+#else
+    const char* dispatch = "threaded";
+#endif
+    cout << dispatch << ": " << code.InstructionCount() << " instructions, "
+         << best / 1e6 << " M instructions/s (last result " << mem[4] << ")" << endl;
+    return 0;
+}
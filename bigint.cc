@@ -0,0 +1,130 @@
+#include <string>
+#include <vector>
+
+#include "bigint.h"
+
+using namespace std;
+
+BigInt::BigInt(__int128 v) : negative(v < 0)
+{
+    // negate as unsigned so the most negative value does not overflow
+    unsigned __int128 m = v < 0 ? (unsigned __int128) 0 - (unsigned __int128) v : (unsigned __int128) v;
+    for (; m != 0; m >>= 32)
+        limbs.push_back((unsigned) m);
+}
+
+bool BigInt::ToWide(__int128& out) const
+{
+    if (limbs.size() > 4)
+        return false;
+    unsigned __int128 m = 0;
+    for (size_t i = limbs.size(); i-- > 0; )
+        m = (m << 32) | limbs[i];
+    unsigned __int128 limit = (unsigned __int128) 1 << 127;     // |INT128_MIN|
+    if (negative ? m > limit : m >= limit)
+        return false;
+    out = negative ? (__int128) ((unsigned __int128) 0 - m) : (__int128) m;
+    return true;
+}
+
+void BigInt::Trim()
+{
+    while (!limbs.empty() && limbs.back() == 0)
+        limbs.pop_back();
+    if (limbs.empty())
+        negative = false;
+}
+
+int BigInt::CompareMagnitude(const BigInt& a, const BigInt& b)
+{
+    if (a.limbs.size() != b.limbs.size())
+        return a.limbs.size() < b.limbs.size() ? -1 : 1;
+    for (size_t i = a.limbs.size(); i-- > 0; ) {
+        if (a.limbs[i] != b.limbs[i])
+            return a.limbs[i] < b.limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+BigInt BigInt::Add(const BigInt& a, const BigInt& b)
+{
+    BigInt result;
+    if (a.negative == b.negative) {
+        const vector<unsigned>& x = a.limbs.size() >= b.limbs.size() ? a.limbs : b.limbs;
+        const vector<unsigned>& y = a.limbs.size() >= b.limbs.size() ? b.limbs : a.limbs;
+        unsigned long long carry = 0;
+        for (size_t i = 0; i < x.size(); i++) {
+            carry += (unsigned long long) x[i] + (i < y.size() ? y[i] : 0);
+            result.limbs.push_back((unsigned) carry);
+            carry >>= 32;
+        }
+        if (carry)
+            result.limbs.push_back((unsigned) carry);
+        result.negative = a.negative;
+    } else {
+        // the sign of the larger magnitude, and the difference of the two
+        int c = CompareMagnitude(a, b);
+        if (c == 0)
+            return result;
+        const BigInt& larger = c > 0 ? a : b;
+        const BigInt& smaller = c > 0 ? b : a;
+        long long borrow = 0;
+        for (size_t i = 0; i < larger.limbs.size(); i++) {
+            long long d = (long long) larger.limbs[i] - (i < smaller.limbs.size() ? smaller.limbs[i] : 0) - borrow;
+            borrow = d < 0;
+            result.limbs.push_back((unsigned) (d + (borrow << 32)));
+        }
+        result.negative = larger.negative;
+    }
+    result.Trim();
+    return result;
+}
+
+BigInt BigInt::Multiply(const BigInt& a, const BigInt& b)
+{
+    BigInt result;
+    if (a.IsZero() || b.IsZero())
+        return result;
+    result.limbs.assign(a.limbs.size() + b.limbs.size(), 0);
+    for (size_t i = 0; i < a.limbs.size(); i++) {
+        unsigned long long carry = 0;
+        for (size_t j = 0; j < b.limbs.size(); j++) {
+            carry += (unsigned long long) a.limbs[i] * b.limbs[j] + result.limbs[i + j];
+            result.limbs[i + j] = (unsigned) carry;
+            carry >>= 32;
+        }
+        result.limbs[i + b.limbs.size()] = (unsigned) carry;
+    }
+    result.negative = a.negative != b.negative;
+    result.Trim();
+    return result;
+}
+
+// Divides a copy of the magnitude by 10^9 repeatedly, nine digits at a time
+string BigInt::ToString() const
+{
+    if (limbs.empty())
+        return "0";
+    vector<unsigned> m = limbs;
+    vector<unsigned> chunks;
+    while (!m.empty()) {
+        unsigned long long rem = 0;
+        for (size_t i = m.size(); i-- > 0; ) {
+            unsigned long long cur = (rem << 32) | m[i];
+            m[i] = (unsigned) (cur / 1000000000);
+            rem = cur % 1000000000;
+        }
+        chunks.push_back((unsigned) rem);
+        while (!m.empty() && m.back() == 0)
+            m.pop_back();
+    }
+
+    string s = negative ? "-" : "";
+    s += to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0; ) {
+        string digits = to_string(chunks[i]);
+        s.append(9 - digits.size(), '0');
+        s += digits;
+    }
+    return s;
+}
@@ -0,0 +1,33 @@
+#ifndef __BIGINT__H__
+#define __BIGINT__H__
+
+#include <string>
+#include <vector>
+
+// BigInt is an arbitrary-precision signed integer, a sign and a magnitude
+// in base 2^32 limbs, least significant first. It only has what exact
+// evaluation needs: addition, multiplication and printing. Values are
+// immutable once built.
+class BigInt {
+  public:
+    BigInt() : negative(false) {}
+    explicit BigInt(__int128 v);
+    // stores the value in out and returns true if it fits in 128 bits
+    bool ToWide(__int128& out) const;
+
+    static BigInt Add(const BigInt& a, const BigInt& b);
+    static BigInt Multiply(const BigInt& a, const BigInt& b);
+
+    bool IsZero() const { return limbs.empty(); }
+    std::string ToString() const;
+
+  private:
+    // compares magnitudes: negative, 0 or positive
+    static int CompareMagnitude(const BigInt& a, const BigInt& b);
+    void Trim();
+
+    bool negative;
+    std::vector<unsigned> limbs;    // no leading zero limbs; empty for 0
+};
+
+#endif  //__BIGINT__H__
@@ -0,0 +1,21 @@
+#ifndef __BITSET__H__
+#define __BITSET__H__
+
+#include <vector>
+#include <cstddef>
+
+// DenseBitset is a set of the integers 0 .. size-1 stored one bit each, for
+// dataflow facts indexed by variable id
+class DenseBitset {
+  public:
+    explicit DenseBitset(size_t size = 0) : words((size + 63) / 64, 0) {}
+
+    bool Test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void Set(size_t i) { words[i >> 6] |= 1ULL << (i & 63); }
+    void Reset(size_t i) { words[i >> 6] &= ~(1ULL << (i & 63)); }
+
+  private:
+    std::vector<unsigned long long> words;
+};
+
+#endif  //__BITSET__H__
@@ -0,0 +1,139 @@
+#!/bin/bash
+
+# Checks --cache DIR. Every provided test is run with an empty cache and
+# then again with the entry the first run stored, and both runs must print
+# what the program prints without a cache, in each execution mode. --dse
+# compiles a different program from the same text, so it must not load an
+# entry stored without it. Entries that do not belong to the program, with
+# a forged hash, a damaged payload or cut short, must be ignored rather than
+# run.
+
+if [ ! -d "./provided_tests" ]; then
+    echo "Error: tests directory not found!"
+    exit 1
+fi
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+
+mkdir -p ./output
+cache=./output/cache
+rm -rf ${cache}
+mkdir -p ${cache}
+
+for test_file in $(find ./provided_tests -type f -name "*.txt" | sort); do
+    all=$((all+1))
+    name=`basename ${test_file} .txt`
+    folder_name="$(cut -d'/' -f3 <<<"${test_file}")"
+    failed=""
+    for mode in "" "--dse" "--exact" "--mod 1000000007" "--jit --jit-threshold 0"; do
+        ./a.out ${mode} < ${test_file} > ./output/${name}.plain
+        ./a.out ${mode} --cache ${cache} < ${test_file} > ./output/${name}.cold
+        ./a.out ${mode} --cache ${cache} < ${test_file} > ./output/${name}.warm
+        if ! cmp -s ./output/${name}.plain ./output/${name}.cold || ! cmp -s ./output/${name}.plain ./output/${name}.warm; then
+            failed="${failed} [${mode}]"
+        fi
+    done
+    if [ -z "${failed}" ]; then
+        count=$((count+1))
+        echo "${folder_name}/${name}: OK"
+    else
+        echo "${folder_name}/${name}: output with --cache differs from the plain run for${failed}"
+    fi
+    rm -f ./output/${name}.plain ./output/${name}.cold ./output/${name}.warm
+done
+rm -rf ${cache}
+
+# Runs $1 with --cache and the options in $4.., and checks that it prints
+# $2 and that --stats reports a cache $3
+check()
+{
+    all=$((all+1))
+    local program=$1 expected=$2 result=$3
+    shift 3
+    local output=$(./a.out "$@" --cache ${cache} --stats < ${program} 2> ./output/cache.stats)
+    local label="$(basename ${program} .txt) [$*]"
+    if [ "${output}" != "${expected}" ]; then
+        echo "${label}: expected \"${expected}\", got \"${output}\""
+    elif ! grep -qx "program cache ${result}" ./output/cache.stats; then
+        echo "${label}: expected a cache ${result}, --stats reported:"
+        cat ./output/cache.stats
+    else
+        count=$((count+1))
+        echo "${label}: OK"
+    fi
+    rm -f ./output/cache.stats
+}
+
+# Writes a program that evaluates F(x) = x + $1 on the input 5. The text
+# before INPUTS has the same length for every one-digit $1.
+generate()
+{
+    echo "TASKS"
+    echo "    2"
+    echo "POLY"
+    echo "    F = x + $1;"
+    echo "EXECUTE"
+    echo "    INPUT a;"
+    echo "    u = F(a);"
+    echo "    v = F(u);"
+    echo "    OUTPUT a;"
+    echo "INPUTS"
+    echo "    5"
+}
+
+# the name of the one entry in the cache
+entry()
+{
+    ls ${cache}/*.pc
+}
+
+mkdir -p ${cache}
+generate 2 > ./output/cache_a.txt
+generate 3 > ./output/cache_b.txt
+
+# --dse drops u and v, so the program it stores is not the plain one
+check ./output/cache_a.txt "5" miss
+check ./output/cache_a.txt "5" hit
+check ./output/cache_a.txt "5" miss --dse
+check ./output/cache_a.txt "5" hit --dse
+check ./output/cache_a.txt "5" hit
+rm -rf ${cache}/*
+
+# An entry for program a under the name, and with the hash, of program b,
+# as if the two hashes collided. b must not run a's code.
+sed -i 's/OUTPUT a;/OUTPUT v;/' ./output/cache_a.txt ./output/cache_b.txt
+check ./output/cache_b.txt "11" miss
+b_entry=$(entry)
+mv ${b_entry} ./output/cache_b.pc
+check ./output/cache_a.txt "9" miss
+a_entry=$(entry)
+# the hash is the 8 bytes at offset 24 of the header
+dd if=./output/cache_b.pc of=${a_entry} bs=1 skip=24 seek=24 count=8 conv=notrunc 2> /dev/null
+mv ${a_entry} ${b_entry}
+check ./output/cache_b.txt "11" miss
+check ./output/cache_b.txt "11" hit
+rm -rf ${cache}/* ./output/cache_b.pc
+
+# a payload with one byte changed, and an entry cut short
+check ./output/cache_b.txt "11" miss
+size=$(stat -c %s $(entry))
+byte=$(od -An -tu1 -j $((size - 5)) -N1 $(entry))
+printf "\\$(printf %o $(( (byte + 1) % 256 )))" | dd of=$(entry) bs=1 seek=$((size - 5)) conv=notrunc 2> /dev/null
+check ./output/cache_b.txt "11" miss
+check ./output/cache_b.txt "11" hit
+truncate -s $((size - 8)) $(entry)
+check ./output/cache_b.txt "11" miss
+check ./output/cache_b.txt "11" hit
+rm -rf ${cache} ./output/cache_a.txt ./output/cache_b.txt
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
@@ -0,0 +1,130 @@
+#ifndef __CHAR_CLASS__H__
+#define __CHAR_CLASS__H__
+
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CC_VECTOR_WIDTH 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CC_VECTOR_WIDTH 16
+#endif
+
+// Locale independent character classes used by the lexer. The Run functions
+// return the length of the longest prefix of p[0..n) whose bytes are all in
+// the class, testing 16 (SSE2) or 32 (AVX2) bytes per step and finishing the
+// last few bytes with the table.
+
+enum CharClass {
+    CC_SPACE = 1,
+    CC_DIGIT = 2,
+    CC_ALPHA = 4,
+    CC_ALNUM = CC_DIGIT | CC_ALPHA
+};
+
+extern const unsigned char char_class[256];
+
+inline bool IsSpaceChar(char c) { return char_class[(unsigned char) c] & CC_SPACE; }
+inline bool IsDigitChar(char c) { return char_class[(unsigned char) c] & CC_DIGIT; }
+inline bool IsAlphaChar(char c) { return char_class[(unsigned char) c] & CC_ALPHA; }
+inline bool IsAlnumChar(char c) { return char_class[(unsigned char) c] & CC_ALNUM; }
+
+inline size_t ScalarRun(const char* p, size_t n, int cls, int* newlines)
+{
+    size_t i = 0;
+    while (i < n && (char_class[(unsigned char) p[i]] & cls)) {
+        if (newlines)
+            *newlines += (p[i] == '\n');
+        i++;
+    }
+    return i;
+}
+
+#if defined(CC_VECTOR_WIDTH)
+
+#if CC_VECTOR_WIDTH == 32
+typedef __m256i cc_vector;
+typedef unsigned cc_mask;
+#define CC_ALL_SET 0xFFFFFFFFu
+#define CC_LOAD(p)        _mm256_loadu_si256((const __m256i*) (p))
+#define CC_SPLAT(c)       _mm256_set1_epi8(c)
+#define CC_EQ(a, b)       _mm256_cmpeq_epi8(a, b)
+#define CC_GT(a, b)       _mm256_cmpgt_epi8(a, b)
+#define CC_AND(a, b)      _mm256_and_si256(a, b)
+#define CC_OR(a, b)       _mm256_or_si256(a, b)
+#define CC_MOVEMASK(a)    ((cc_mask) _mm256_movemask_epi8(a))
+#else
+typedef __m128i cc_vector;
+typedef unsigned cc_mask;
+#define CC_ALL_SET 0xFFFFu
+#define CC_LOAD(p)        _mm_loadu_si128((const __m128i*) (p))
+#define CC_SPLAT(c)       _mm_set1_epi8(c)
+#define CC_EQ(a, b)       _mm_cmpeq_epi8(a, b)
+#define CC_GT(a, b)       _mm_cmpgt_epi8(a, b)
+#define CC_AND(a, b)      _mm_and_si128(a, b)
+#define CC_OR(a, b)       _mm_or_si128(a, b)
+#define CC_MOVEMASK(a)    ((cc_mask) _mm_movemask_epi8(a))
+#endif
+
+// Signed byte compares are enough here: bytes >= 0x80 are negative and fall
+// outside every class.
+inline cc_vector VectorClassMask(cc_vector v, int cls)
+{
+    cc_vector m = CC_SPLAT(0);
+    if (cls & CC_SPACE) {
+        cc_vector ctl = CC_AND(CC_GT(v, CC_SPLAT('\t' - 1)), CC_GT(CC_SPLAT('\r' + 1), v));
+        m = CC_OR(m, CC_OR(CC_EQ(v, CC_SPLAT(' ')), ctl));
+    }
+    if (cls & CC_DIGIT)
+        m = CC_OR(m, CC_AND(CC_GT(v, CC_SPLAT('0' - 1)), CC_GT(CC_SPLAT('9' + 1), v)));
+    if (cls & CC_ALPHA) {
+        cc_vector lower = CC_OR(v, CC_SPLAT(0x20));
+        m = CC_OR(m, CC_AND(CC_GT(lower, CC_SPLAT('a' - 1)), CC_GT(CC_SPLAT('z' + 1), lower)));
+    }
+    return m;
+}
+
+// Most runs are a few bytes long (single spaces, short names and numbers),
+// where setting up vector compares costs more than it saves, so the first
+// CC_SCALAR_PREFIX bytes are always checked with the table.
+#define CC_SCALAR_PREFIX 8
+
+inline size_t VectorRun(const char* p, size_t n, int cls, int* newlines)
+{
+    size_t i = ScalarRun(p, n < CC_SCALAR_PREFIX ? n : CC_SCALAR_PREFIX, cls, newlines);
+    if (i < CC_SCALAR_PREFIX)
+        return i;
+    while (i + CC_VECTOR_WIDTH <= n) {
+        cc_vector v = CC_LOAD(p + i);
+        cc_mask in_class = CC_MOVEMASK(VectorClassMask(v, cls));
+        if (in_class == CC_ALL_SET) {
+            if (newlines)
+                *newlines += __builtin_popcount(CC_MOVEMASK(CC_EQ(v, CC_SPLAT('\n'))));
+            i += CC_VECTOR_WIDTH;
+            continue;
+        }
+        int k = __builtin_ctz(~in_class);
+        if (newlines && k > 0) {
+            cc_mask nl = CC_MOVEMASK(CC_EQ(v, CC_SPLAT('\n')));
+            *newlines += __builtin_popcount(nl & ((1u << k) - 1));
+        }
+        return i + k;
+    }
+    return i + ScalarRun(p + i, n - i, cls, newlines);
+}
+
+#endif
+
+// Length of the run of bytes in class cls at the start of p[0..n). If
+// newlines is not NULL the '\n' bytes inside the run are added to it.
+inline size_t ClassRun(const char* p, size_t n, int cls, int* newlines = NULL)
+{
+#if defined(CC_VECTOR_WIDTH)
+    return VectorRun(p, n, cls, newlines);
+#else
+    return ScalarRun(p, n, cls, newlines);
+#endif
+}
+
+#endif  //__CHAR_CLASS__H__
@@ -0,0 +1,239 @@
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+#include "dag.h"
+
+using namespace std;
+
+// Multiply-adds one evaluation of p takes: the steps, two per bit of each
+// power, and gathering the arguments
+static long PolynomialCost(const CompiledPolynomial& p)
+{
+    long cost = p.param_count + p.step_begin[p.sum_count];
+    for (int i = 0; i < p.power_count; i++) {
+        for (unsigned e = p.power_step[i]; e != 0; e >>= 1)
+            cost += 2;
+    }
+    return cost;
+}
+
+ParallelExecutor::ParallelExecutor(const Bytecode& bytecode, const vector<const CompiledPolynomial*>& polys,
+                                   int slot_count, int thread_count)
+    : polys(polys), thread_count(thread_count > 0 ? thread_count : max(1u, thread::hardware_concurrency())),
+      expensive_count(0), expensive_work(0), output_count(0)
+{
+    vector<long> poly_cost;
+    for (size_t i = 0; i < polys.size(); i++)
+        poly_cost.push_back(PolynomialCost(*polys[i]));
+
+    // per slot, the last instruction to write it and the ones that have
+    // read it since, as linked lists
+    vector<int> last_writer(slot_count, -1);
+    vector<int> read_head(slot_count, -1);
+    vector<int> read_next, read_node;
+    vector<pair<int, int> > edges;
+    int input_count = 0;
+
+    auto read = [&](int slot, int node) {
+        if (last_writer[slot] >= 0)
+            edges.push_back(make_pair(last_writer[slot], node));
+        read_next.push_back(read_head[slot]);
+        read_node.push_back(node);
+        read_head[slot] = read_node.size() - 1;
+    };
+    auto write = [&](int slot, int node) {
+        if (read_head[slot] < 0 && last_writer[slot] >= 0)
+            edges.push_back(make_pair(last_writer[slot], node));
+        for (int r = read_head[slot]; r >= 0; r = read_next[r]) {
+            if (read_node[r] != node)
+                edges.push_back(make_pair(read_node[r], node));
+        }
+        read_head[slot] = -1;
+        last_writer[slot] = node;
+    };
+
+    for (const int* pc = bytecode.Code(); *pc != OP_HALT; ) {
+        int node = node_pc.size();
+        node_pc.push_back(pc);
+        node_index.push_back(0);
+        node_cost.push_back(1);
+        switch (*pc) {
+            case OP_INPUT:
+                node_index[node] = input_count++;
+                write(pc[1], node);
+                pc += 2;
+                break;
+            case OP_OUTPUT:
+                node_index[node] = output_count++;
+                read(pc[1], node);
+                pc += 2;
+                break;
+            case OP_CONST:
+                write(pc[1], node);
+                pc += 3;
+                break;
+            default:    // OP_EVAL
+                for (int i = 0; i < pc[3]; i++)
+                    read(pc[4 + i], node);
+                write(pc[2], node);
+                node_cost[node] = poly_cost[pc[1]];
+                if (Expensive(node)) {
+                    expensive_count++;
+                    expensive_work += node_cost[node];
+                }
+                pc += 4 + pc[3];
+                break;
+        }
+    }
+
+    // successor lists, in the order the edges were found
+    int n = node_pc.size();
+    predecessor_count.assign(n, 0);
+    successor_begin.assign(n + 1, 0);
+    for (size_t e = 0; e < edges.size(); e++) {
+        successor_begin[edges[e].first + 1]++;
+        predecessor_count[edges[e].second]++;
+    }
+    for (int i = 0; i < n; i++)
+        successor_begin[i + 1] += successor_begin[i];
+    successors.resize(edges.size());
+    vector<int> fill(successor_begin.begin(), successor_begin.end() - 1);
+    for (size_t e = 0; e < edges.size(); e++)
+        successors[fill[edges[e].first]++] = edges[e].second;
+}
+
+bool ParallelExecutor::Worthwhile() const
+{
+    return thread_count > 1 && expensive_count > 1 && expensive_work >= PARALLEL_MIN_WORK;
+}
+
+void ParallelExecutor::Run(VirtualMachine& vm, int* mem, const vector<int>& inputs, OutputSink& out)
+{
+    int n = node_pc.size();
+    unique_ptr<atomic<int>[]> pending(new atomic<int>[n]);
+    for (int i = 0; i < n; i++)
+        pending[i].store(predecessor_count[i], memory_order_relaxed);
+    vector<int> outputs(output_count);
+    atomic<long> remaining(n);
+
+    // Ready nodes: cheap ones the calling thread found go on local and are
+    // run without locking; the others go through the shared queues.
+    vector<int> local;
+    mutex lock;
+    condition_variable work_ready, main_ready;
+    deque<int> shared;          // expensive nodes, for any thread
+    deque<int> handed_back;     // cheap nodes made ready by another thread
+    bool stop = false;
+
+    auto execute = [&](int node, VirtualMachine& machine) {
+        const int* pc = node_pc[node];
+        switch (*pc) {
+            case OP_INPUT:
+                mem[pc[1]] = node_index[node] < (int) inputs.size() ? inputs[node_index[node]] : 0;
+                break;
+            case OP_OUTPUT:
+                outputs[node_index[node]] = mem[pc[1]];
+                break;
+            case OP_CONST:
+                mem[pc[1]] = pc[2];
+                break;
+            default:
+                mem[pc[2]] = machine.Evaluate(pc, mem);
+                break;
+        }
+    };
+    auto release = [&](int node, bool on_main) {
+        for (int s = successor_begin[node]; s < successor_begin[node + 1]; s++) {
+            int next = successors[s];
+            if (pending[next].fetch_sub(1, memory_order_acq_rel) != 1)
+                continue;
+            if (on_main && !Expensive(next)) {
+                local.push_back(next);
+                continue;
+            }
+            lock_guard<mutex> guard(lock);
+            if (Expensive(next)) {
+                shared.push_back(next);
+                work_ready.notify_one();
+            } else {
+                handed_back.push_back(next);
+            }
+            main_ready.notify_one();
+        }
+        if (remaining.fetch_sub(1, memory_order_acq_rel) == 1) {
+            lock_guard<mutex> guard(lock);
+            main_ready.notify_one();
+        }
+    };
+
+    for (int i = n - 1; i >= 0; i--) {
+        if (predecessor_count[i] == 0) {
+            if (Expensive(i))
+                shared.push_back(i);
+            else
+                local.push_back(i);
+        }
+    }
+
+    vector<thread> workers;
+    for (int t = 1; t < thread_count; t++) {
+        workers.push_back(thread([&]() {
+            VirtualMachine machine(polys);
+            for (;;) {
+                int node;
+                {
+                    unique_lock<mutex> guard(lock);
+                    work_ready.wait(guard, [&]() { return stop || !shared.empty(); });
+                    if (shared.empty())
+                        return;
+                    node = shared.front();
+                    shared.pop_front();
+                }
+                execute(node, machine);
+                release(node, false);
+            }
+        }));
+    }
+
+    // The calling thread runs the cheap nodes, and helps with the
+    // expensive ones when it has nothing else to do.
+    for (;;) {
+        int node;
+        if (!local.empty()) {
+            node = local.back();
+            local.pop_back();
+        } else {
+            unique_lock<mutex> guard(lock);
+            main_ready.wait(guard, [&]() {
+                return !handed_back.empty() || !shared.empty() || remaining.load() == 0;
+            });
+            if (!handed_back.empty()) {
+                node = handed_back.front();
+                handed_back.pop_front();
+            } else if (!shared.empty()) {
+                node = shared.front();
+                shared.pop_front();
+            } else {
+                break;
+            }
+        }
+        execute(node, vm);
+        release(node, true);
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+        work_ready.notify_all();
+    }
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+
+    for (int i = 0; i < output_count; i++)
+        out << outputs[i] << '\n';
+}
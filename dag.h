@@ -0,0 +1,62 @@
+#ifndef __DAG__H__
+#define __DAG__H__
+
+#include <vector>
+
+#include "poly.h"
+#include "vm.h"
+
+// estimated cost, in multiply-adds, from which an EVAL is worth handing to
+// another thread; cheaper instructions run on the calling thread
+#ifndef PARALLEL_MIN_COST
+#define PARALLEL_MIN_COST 256
+#endif
+// total cost of the expensive EVALs below which a program runs serially
+#ifndef PARALLEL_MIN_WORK
+#define PARALLEL_MIN_WORK (1 << 16)
+#endif
+
+// ParallelExecutor runs the EXECUTE bytecode as a dependency graph. There
+// is a node for every instruction and an edge wherever two instructions
+// touch the same memory slot and one of them writes it: read after write,
+// and, because slots are shared between variables, write after read and
+// write after write too. The k-th INPUT always reads input k and the k-th
+// OUTPUT fills line k of the output, so neither needs an order of its own
+// beyond its slot. Nodes whose inputs are ready run on a pool of threads,
+// except that nodes below PARALLEL_MIN_COST stay on the calling thread.
+// The output is written in program order once everything has run.
+class ParallelExecutor {
+  public:
+    ParallelExecutor(const Bytecode& bytecode, const std::vector<const CompiledPolynomial*>& polys,
+                     int slot_count, int thread_count);
+
+    // false if there is too little expensive work, or too few threads, for
+    // running in parallel to pay off
+    bool Worthwhile() const;
+
+    // vm evaluates on the calling thread; the other threads get plain
+    // VirtualMachines of their own
+    void Run(VirtualMachine& vm, int* mem, const std::vector<int>& inputs, OutputSink& out);
+
+    long NodeCount() const { return node_pc.size(); }
+    long EdgeCount() const { return successors.size(); }
+    long ExpensiveCount() const { return expensive_count; }
+    int ThreadCount() const { return thread_count; }
+
+  private:
+    bool Expensive(int node) const { return node_cost[node] >= PARALLEL_MIN_COST; }
+
+    std::vector<const CompiledPolynomial*> polys;
+    int thread_count;
+    std::vector<const int*> node_pc;
+    std::vector<int> node_index;        // INPUT: input read, OUTPUT: line written
+    std::vector<long> node_cost;
+    std::vector<int> predecessor_count;
+    std::vector<int> successor_begin;   // node_pc.size() + 1 offsets into successors
+    std::vector<int> successors;
+    long expensive_count;
+    long expensive_work;
+    int output_count;
+};
+
+#endif  //__DAG__H__
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "driver.h"
+#include "threadpool.h"
+
+using namespace std;
+
+bool CollectProgramFiles(const string& path, vector<string>& files)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    if (!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return true;
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if (dir == NULL)
+        return false;
+    vector<string> entries;
+    for (struct dirent* e = readdir(dir); e != NULL; e = readdir(dir)) {
+        string name = e->d_name;
+        if (name != "." && name != "..")
+            entries.push_back(name);
+    }
+    closedir(dir);
+    sort(entries.begin(), entries.end());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        string child = path + "/" + entries[i];
+        if (stat(child.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            CollectProgramFiles(child, files);
+        else if (child.size() > 4 && child.compare(child.size() - 4, 4, ".txt") == 0)
+            files.push_back(child);
+    }
+    return true;
+}
+
+namespace {
+
+// Outputs wait here until every file before them has been written
+class OrderedWriter {
+  public:
+    explicit OrderedWriter(size_t count)
+        : outputs(count), names(count), finished(count, false), next(0), failed(false) {}
+
+    void Finish(size_t i, const string& file, string& output);
+    bool Failed() const { return failed; }
+
+  private:
+    mutex lock;
+    vector<string> outputs;
+    vector<string> names;
+    vector<bool> finished;
+    size_t next;
+    bool failed;
+};
+
+void OrderedWriter::Finish(size_t i, const string& file, string& output)
+{
+    lock_guard<mutex> guard(lock);
+    outputs[i].swap(output);
+    names[i] = file;
+    finished[i] = true;
+    for (; next < outputs.size() && finished[next]; next++) {
+        ofstream out((names[next] + ".output").c_str(), ios::binary);
+        out << outputs[next];
+        if (!out) {
+            cerr << "cannot write " << names[next] << ".output" << endl;
+            failed = true;
+        }
+        string().swap(outputs[next]);
+    }
+}
+
+}  // namespace
+
+int RunProgramFiles(const vector<string>& files, const ExecutionOptions& options, int thread_count)
+{
+    // statistics of single programs would be interleaved, and the files
+    // already keep every thread busy
+    ExecutionOptions program_options = options;
+    program_options.stats = false;
+    program_options.parallel = false;
+
+    WorkStealingPool pool(thread_count);
+    OrderedWriter writer(files.size());
+    mutex error_lock;
+    bool unreadable = false;
+
+    auto start = chrono::steady_clock::now();
+    pool.Run(files.size(), [&](size_t i) {
+        string output;
+        int fd = open(files[i].c_str(), O_RDONLY);
+        if (fd < 0) {
+            lock_guard<mutex> guard(error_lock);
+            cerr << "cannot open " << files[i] << endl;
+            unreadable = true;
+        } else {
+            // each thread reuses one arena for all the programs it runs,
+            // and the blocks of the last one are kept for the next
+            static thread_local Arena arena;
+            arena.Reset();
+            OutputSink buffer(output);
+            Parser parser(buffer, program_options, fd, &arena);
+            parser.ConsumeAllInput();
+            buffer.Flush();
+            close(fd);
+        }
+        writer.Finish(i, files[i], output);
+    });
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    if (options.stats) {
+        cerr << "ran " << files.size() << " programs on " << pool.ThreadCount()
+             << " threads in " << elapsed.count() << " s" << endl;
+    }
+    return unreadable || writer.Failed() ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+#ifndef __DRIVER__H__
+#define __DRIVER__H__
+
+#include <string>
+#include <vector>
+
+#include "parser.h"
+
+// Adds the program files named by path to files: path itself if it is a
+// file, or every *.txt file below it, in sorted order, if it is a directory.
+// Returns false if path does not exist.
+bool CollectProgramFiles(const std::string& path, std::vector<std::string>& files);
+
+// Runs every file in files as a program of its own, with each program's
+// whole pipeline on a WorkStealingPool of thread_count threads. What a
+// program prints is kept in a buffer of its own and written to
+// <file>.output, in the order of files, as soon as it and every file
+// before it have finished. Returns 0, or 1 if a file could not be read or
+// its output could not be written.
+int RunProgramFiles(const std::vector<std::string>& files, const ExecutionOptions& options,
+                    int thread_count);
+
+#endif  //__DRIVER__H__
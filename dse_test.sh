@@ -0,0 +1,138 @@
+#!/bin/bash
+
+# Checks --dse. Evaluations whose value never reaches an OUTPUT are
+# dropped, but everything the program prints stays the same: the OUTPUT
+# lines, because evaluations have no side effects and every INPUT is kept,
+# and the warnings, which are found before any instruction is dropped.
+# Each case pins the output and the number of evaluations --stats reports
+# as skipped, and the provided tests must print the same with --dse as
+# without it, alone and with the other execution modes.
+
+if [ ! -d "./provided_tests" ]; then
+    echo "Error: tests directory not found!"
+    exit 1
+fi
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+
+mkdir -p ./output
+
+# Runs the program on stdin with --dse and checks that it prints $2, and
+# without --dse as well, and that --stats reports $3 evaluations skipped
+check()
+{
+    all=$((all+1))
+    local name=$1 expected=$2 skipped=$3 program=./output/dse_$1.txt
+    cat > ${program}
+    local plain=$(./a.out < ${program})
+    local dse=$(./a.out --dse --stats < ${program} 2> ./output/dse_${name}.stats)
+    if [ "${dse}" != "${expected}" ]; then
+        echo "dse_${name}: expected:"
+        echo "${expected}"
+        echo "got:"
+        echo "${dse}"
+    elif [ "${plain}" != "${expected}" ]; then
+        echo "dse_${name}: output without --dse differs from the expected output:"
+        echo "${plain}"
+    elif ! grep -qx "dead-store elimination skipped ${skipped} evaluations" ./output/dse_${name}.stats; then
+        echo "dse_${name}: expected ${skipped} evaluations skipped, --stats reported:"
+        cat ./output/dse_${name}.stats
+    else
+        count=$((count+1))
+        echo "dse_${name}: OK"
+    fi
+    rm -f ${program} ./output/dse_${name}.stats
+}
+
+# u on line 9 is overwritten before it is read, v on line 10 and w on
+# line 13 are never read. The G inside F on line 10 only feeds v, so it
+# goes too: 4 evaluations. The warnings still name lines 9, 10 and 13.
+check warnings "7
+4
+11
+Warning Code 1: 13
+Warning Code 2: 9 10 13" 4 <<'EOF'
+TASKS
+    1 2 3 4
+POLY
+    F(x) = 2 x + 1;
+    G(x, y) = x y + y^2;
+EXECUTE
+    INPUT a;
+    INPUT b;
+    u = G(a, b);
+    v = F(G(b, a));
+    u = F(a);
+    OUTPUT u;
+    w = G(u, q);
+    OUTPUT b;
+    INPUT a;
+    z = F(a);
+    OUTPUT z;
+INPUTS
+    3 4 5
+EOF
+
+# Nothing that is evaluated is output, but INPUT e still reads the third
+# value rather than the first
+check all_dead "3" 3 <<'EOF'
+TASKS
+    2
+POLY
+    F(x, y) = x^2 y - 3 x + y;
+EXECUTE
+    INPUT a;
+    INPUT b;
+    c = F(a, 4);
+    d = F(F(c, b), a);
+    INPUT e;
+    OUTPUT e;
+INPUTS
+    1 2 3
+EOF
+
+# Every evaluation feeds the OUTPUT, so none is dropped
+check all_live "1259" 0 <<'EOF'
+TASKS
+    2
+POLY
+    F(x, y) = x^2 y - 3 x + y;
+EXECUTE
+    INPUT a;
+    INPUT b;
+    c = F(a, 4);
+    d = F(F(c, b), a);
+    OUTPUT d;
+INPUTS
+    1 2
+EOF
+
+for test_file in $(find ./provided_tests -type f -name "*.txt" | sort); do
+    all=$((all+1))
+    name=`basename ${test_file} .txt`
+    folder_name="$(cut -d'/' -f3 <<<"${test_file}")"
+    failed=""
+    for mode in "" "--jit --jit-threshold 0" "--memo" "--parallel --threads 4" "--exact" "--mod 1000000007"; do
+        if ! cmp -s <(./a.out ${mode} < ${test_file}) <(./a.out --dse ${mode} < ${test_file}); then
+            failed="${failed} [${mode}]"
+        fi
+    done
+    if [ -z "${failed}" ]; then
+        count=$((count+1))
+        echo "${folder_name}/${name}: OK"
+    else
+        echo "${folder_name}/${name}: output with --dse differs for${failed}"
+    fi
+done
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
@@ -0,0 +1,188 @@
+#include <vector>
+#include <algorithm>
+
+#include "exact.h"
+#include "parser.h"
+
+using namespace std;
+
+// Compiles a term list into a new sum of out and returns its index. Its
+// sub-expressions are compiled first, so they get lower indices.
+static int CompileExactSum(const struct term_list* list, ExactPolynomial& out)
+{
+    // factors of the terms of this sum, gathered before the sum is laid out
+    vector<long long> coefficients;
+    vector<int> term_end;
+    vector<int> slots, exponents;
+    bool negate = false;
+
+    for (; list; list = list->next) {
+        size_t first = slots.size();
+        bool zero = false;
+        for (const struct monomial_list* m = list->term.monomial_list; m && !zero; m = m->next) {
+            const Primary* primary = m->monomial.primary;
+            int exponent = m->monomial.exponent;
+            if (exponent <= 0)      // x^0 is 1, as is 0^0
+                continue;
+            if (primary->kind == VAR) {
+                if (primary->var < 0)
+                    zero = true;    // not a parameter, so always 0
+                slots.push_back(primary->var);
+            } else {
+                slots.push_back(out.param_count + CompileExactSum(primary->t_list, out));
+            }
+            exponents.push_back(exponent);
+        }
+        if (zero) {
+            slots.resize(first);
+            exponents.resize(first);
+        } else {
+            long long c = (unsigned) list->term.coefficient;
+            coefficients.push_back(negate ? -c : c);
+            term_end.push_back(slots.size());
+        }
+        negate = list->op == OP_MINUS;
+    }
+
+    for (size_t t = 0; t < coefficients.size(); t++) {
+        out.coefficients.push_back(coefficients[t]);
+        for (int f = t > 0 ? term_end[t - 1] : 0; f < term_end[t]; f++) {
+            out.factor_slot.push_back(slots[f]);
+            out.factor_exponent.push_back(exponents[f]);
+        }
+        out.term_begin.push_back(out.factor_slot.size());
+    }
+    out.sum_begin.push_back(out.coefficients.size());
+    return out.sum_count++;
+}
+
+void CompileExact(const struct term_list* body, int param_count, ExactPolynomial& out)
+{
+    out.param_count = param_count;
+    out.sum_count = 0;
+    out.sum_begin.assign(1, 0);
+    out.coefficients.clear();
+    out.term_begin.assign(1, 0);
+    out.factor_slot.clear();
+    out.factor_exponent.clear();
+    CompileExactSum(body, out);
+}
+
+ExactMachine::ExactMachine(const vector<const ExactPolynomial*>& polys)
+    : polys(polys), evaluations(0), wide_results(0), big_results(0)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < polys.size(); i++)
+        size = max(size, (size_t) (polys[i]->param_count + polys[i]->sum_count));
+    table.resize(size);
+    small_table.resize(size);
+}
+
+// base^exponent by squaring, for exponents > 0; false if it overflows
+static bool PowerSmall(long long base, unsigned exponent, long long& result)
+{
+    result = 1;
+    for (;;) {
+        if ((exponent & 1) && __builtin_mul_overflow(result, base, &result))
+            return false;
+        exponent >>= 1;
+        if (exponent == 0)
+            return true;
+        if (__builtin_mul_overflow(base, base, &base))
+            return false;
+    }
+}
+
+bool ExactMachine::EvaluateSmall(const ExactPolynomial& p, const int* args, int argc, const vector<Number>& mem,
+                                 long long& result)
+{
+    long long* t = small_table.data();
+    for (int i = 0; i < p.param_count; i++) {
+        t[i] = 0;
+        if (i < argc && !mem[args[i]].GetSmall(t[i]))
+            return false;
+    }
+
+    for (int s = 0; s < p.sum_count; s++) {
+        long long sum = 0;
+        for (int term = p.sum_begin[s]; term < p.sum_begin[s + 1]; term++) {
+            long long product = p.coefficients[term];
+            for (int f = p.term_begin[term]; f < p.term_begin[term + 1]; f++) {
+                long long power;
+                if (!PowerSmall(t[p.factor_slot[f]], p.factor_exponent[f], power) ||
+                    __builtin_mul_overflow(product, power, &product))
+                    return false;
+            }
+            if (__builtin_add_overflow(sum, product, &sum))
+                return false;
+        }
+        t[p.param_count + s] = sum;
+    }
+    result = t[p.param_count + p.sum_count - 1];
+    return true;
+}
+
+Number ExactMachine::Evaluate(const ExactPolynomial& p, const int* args, int argc, const vector<Number>& mem)
+{
+    Number* t = table.data();
+    for (int i = 0; i < p.param_count; i++)
+        t[i] = i < argc ? mem[args[i]] : Number(0);
+
+    for (int s = 0; s < p.sum_count; s++) {
+        Number sum;
+        for (int term = p.sum_begin[s]; term < p.sum_begin[s + 1]; term++) {
+            Number product(p.coefficients[term]);
+            for (int f = p.term_begin[term]; f < p.term_begin[term + 1]; f++) {
+                const Number& base = t[p.factor_slot[f]];
+                product = product * (p.factor_exponent[f] == 1 ? base : Number::Power(base, p.factor_exponent[f]));
+            }
+            sum = sum + product;
+        }
+        t[p.param_count + s] = sum;
+    }
+    return t[p.param_count + p.sum_count - 1];
+}
+
+// Numbers in the program text are never negative, so the ints the lexer
+// read them into are taken as unsigned: literals up to 2^32 - 1 are exact.
+void ExactMachine::Run(const Bytecode& bytecode, int slot_count, const vector<int>& inputs, OutputSink& out)
+{
+    vector<Number> mem(max(slot_count, 1));
+    size_t next_input = 0;
+
+    for (const int* pc = bytecode.Code(); ; ) {
+        switch (*pc) {
+            case OP_INPUT:
+                mem[pc[1]] = next_input < inputs.size() ? (long long) (unsigned) inputs[next_input++] : 0;
+                pc += 2;
+                break;
+            case OP_OUTPUT:
+                out << mem[pc[1]] << '\n';
+                pc += 2;
+                break;
+            case OP_CONST:
+                mem[pc[1]] = (long long) (unsigned) pc[2];
+                pc += 3;
+                break;
+            case OP_EVAL: {
+                long long small;
+                evaluations++;
+                if (EvaluateSmall(*polys[pc[1]], pc + 4, pc[3], mem, small)) {
+                    mem[pc[2]] = small;
+                    pc += 4 + pc[3];
+                    break;
+                }
+                Number value = Evaluate(*polys[pc[1]], pc + 4, pc[3], mem);
+                if (value.GetWidth() == Number::WIDE)
+                    wide_results++;
+                else if (value.GetWidth() == Number::BIG)
+                    big_results++;
+                mem[pc[2]] = value;
+                pc += 4 + pc[3];
+                break;
+            }
+            default:
+                return;
+        }
+    }
+}
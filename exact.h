@@ -0,0 +1,59 @@
+#ifndef __EXACT__H__
+#define __EXACT__H__
+
+#include <vector>
+
+#include "number.h"
+#include "vm.h"
+
+struct term_list;
+
+// ExactPolynomial is a polynomial body in the sum-of-terms layout of
+// CompiledPolynomial, with the coefficients kept exact. CompilePolynomial()
+// can not be reused for it: merging terms and folding (c x)^e into c^e x^e
+// compute new coefficients with 32-bit wrap-around, so this form is taken
+// straight from the AST and does neither.
+struct ExactPolynomial {
+    int param_count;
+    int sum_count;
+    std::vector<int> sum_begin;             // sum_count + 1 offsets into the term arrays
+    std::vector<long long> coefficients;    // one per term, sign included
+    std::vector<int> term_begin;            // term_count + 1 offsets into the factor arrays
+    std::vector<int> factor_slot;           // parameter, or param_count + index of a sum
+    std::vector<int> factor_exponent;       // always positive
+};
+
+void CompileExact(const struct term_list* body, int param_count, ExactPolynomial& out);
+
+// ExactMachine runs Bytecode the way VirtualMachine does, but evaluates over
+// Numbers, so nothing overflows: each value is as wide as it needs to be and
+// is printed exactly. An evaluation is first tried on plain 64-bit ints with
+// checked arithmetic, and only redone over Numbers if one of its arguments
+// or intermediate values does not fit.
+class ExactMachine {
+  public:
+    explicit ExactMachine(const std::vector<const ExactPolynomial*>& polys);
+
+    // Inputs past the end of inputs read as 0
+    void Run(const Bytecode& bytecode, int slot_count, const std::vector<int>& inputs, OutputSink& out);
+
+    long EvaluationCount() const { return evaluations; }
+    // evaluations whose result needed 128 bits, and more than 128 bits
+    long WideCount() const { return wide_results; }
+    long BigCount() const { return big_results; }
+
+  private:
+    // false if an argument or an intermediate value does not fit in 64 bits
+    bool EvaluateSmall(const ExactPolynomial& p, const int* args, int argc, const std::vector<Number>& mem,
+                       long long& result);
+    Number Evaluate(const ExactPolynomial& p, const int* args, int argc, const std::vector<Number>& mem);
+
+    std::vector<const ExactPolynomial*> polys;
+    std::vector<Number> table;      // parameters and sum values while evaluating
+    std::vector<long long> small_table;     // the same for EvaluateSmall()
+    long evaluations;
+    long wide_results;
+    long big_results;
+};
+
+#endif  //__EXACT__H__
@@ -0,0 +1,152 @@
+#!/bin/bash
+
+# Checks --exact against values worked out independently. The cases widen
+# results past 32 bits, past 64 bits into 128, and past 128 bits into a
+# BigInt, on both sides of each boundary, with negative results, carries
+# from one word into the next, results fed back as arguments, and a result
+# that shrinks back to a small value. --stats must count the results that
+# needed 128 bits and more. The provided tests never overflow, so they
+# must print the same with --exact as without it.
+
+if [ ! -d "./provided_tests" ]; then
+    echo "Error: tests directory not found!"
+    exit 1
+fi
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+
+mkdir -p ./output
+
+# Runs the program on stdin with --exact and checks that it prints $2 and
+# that --stats reports $3
+check()
+{
+    all=$((all+1))
+    local name=$1 expected=$2 stats=$3 program=./output/exact_$1.txt
+    cat > ${program}
+    local output=$(./a.out --exact --stats < ${program} 2> ./output/exact_${name}.stats)
+    if [ "${output}" != "${expected}" ]; then
+        echo "exact_${name}: output does not match expected:"
+        echo "--------------------------------------------------------"
+        diff <(echo "${expected}") <(echo "${output}")
+    elif ! grep -qxF "${stats}" ./output/exact_${name}.stats; then
+        echo "exact_${name}: expected \"${stats}\" from --stats, got:"
+        cat ./output/exact_${name}.stats
+    else
+        count=$((count+1))
+        echo "exact_${name}: OK"
+    fi
+    rm -f ${program} ./output/exact_${name}.stats
+}
+
+# b is 2^32 - 1. 3037000499^2 - 1 fits in 64 bits and 3037000500^2 - 1
+# does not; 3037000499^4 fits in 128 bits and b^4 does not. t is b^2 + 1,
+# and v = t^2 + 1, so S(t, v) comes back down to -1.
+check boundaries "4294967297
+18446744065119617026
+-8589934590
+9223372030926249000
+9223372037000249999
+85070591620872599158135621271853498001
+340282366604025813516997721482669850625
+1461501635969773451074528116351954488654294941696
+-340282366604025813516997721478374883330
+8769009818881182006992595294355664597250077622271
+340282366604025813553891209612909084677
+-1
+-1361129466416103254215564838451636338708" "exact: 14 evaluations, 4 needed 128 bits, 6 needed more" <<'EOF'
+TASKS
+    2
+POLY
+    F(x) = x^2 + 1;
+    G(x, y) = x y - 3 y;
+    H(x) = x^5 + x^4 + x^3 + x^2 + x + 1;
+    K(x) = x - x^4;
+    D(x) = (x + 1)^6 - x^6;
+    M(x) = x^2 - 1;
+    T(x) = x^4;
+    S(x, y) = x^2 - y;
+EXECUTE
+    INPUT a;
+    INPUT b;
+    INPUT c;
+    INPUT d;
+    INPUT e;
+    w = F(a);
+    OUTPUT w;
+    w = F(b);
+    OUTPUT w;
+    w = G(c, b);
+    OUTPUT w;
+    w = M(e);
+    OUTPUT w;
+    w = M(d);
+    OUTPUT w;
+    w = T(e);
+    OUTPUT w;
+    w = T(b);
+    OUTPUT w;
+    w = H(b);
+    OUTPUT w;
+    w = K(b);
+    OUTPUT w;
+    w = D(b);
+    OUTPUT w;
+    t = F(b);
+    v = F(t);
+    OUTPUT v;
+    s = S(t, v);
+    OUTPUT s;
+    s = G(s, v);
+    OUTPUT s;
+INPUTS
+    65536 4294967295 1 3037000500 3037000499
+EOF
+
+# (b + 1)^12 is 2^384, so every word of it but the top one is 0. Every
+# intermediate value of b^12 carries into the next word. The last result
+# is negative and as wide as the others.
+check carries "39402006196394479212279040100143613805079739270465446667948293404245721771497210611414266254884915640806627990306816
+110087933426548288295950449489264717674109535528515207421701512481848320769476383260824602871010709777416191
+-110087933426548288295950449489264717674109535528515207421701512481848320769476383260824602871010709777416191" "exact: 5 evaluations, 0 needed 128 bits, 5 needed more" <<'EOF'
+TASKS
+    2
+POLY
+    E(x) = (x + 1)^12;
+    L(x) = (x + 1)^12 - x^12;
+    Z(x, y) = x - y;
+EXECUTE
+    INPUT b;
+    u = E(b);
+    OUTPUT u;
+    v = L(b);
+    OUTPUT v;
+    w = Z(Z(u, v), E(b));
+    OUTPUT w;
+INPUTS
+    4294967295
+EOF
+
+for test_file in $(find ./provided_tests -type f -name "*.txt" | sort); do
+    all=$((all+1))
+    name=`basename ${test_file} .txt`
+    folder_name="$(cut -d'/' -f3 <<<"${test_file}")"
+    if cmp -s <(./a.out < ${test_file}) <(./a.out --exact < ${test_file}); then
+        count=$((count+1))
+        echo "${folder_name}/${name}: OK"
+    else
+        echo "${folder_name}/${name}: output with --exact differs from the plain run"
+    fi
+done
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
@@ -1,42 +1,128 @@
-
 #include <iostream>
-#include <istream>
 #include <vector>
 #include <string>
 #include <cstdio>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "inputbuf.h"
 
 using namespace std;
 
-bool InputBuffer::EndOfInput()
+// size of each read() when the input is a pipe or terminal
+#define INPUT_BLOCK_SIZE (1 << 20)
+
+InputBuffer::InputBuffer(int fd) : fd(fd)
+{
+    mapped = false;
+    eof = false;
+    data = NULL;
+    size = 0;
+    pos = 0;
+
+    // Map regular files starting from the current offset of fd. Anything
+    // else (pipes, terminals, empty files) falls back to block reads.
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset < 0)
+            offset = 0;
+        if (offset < st.st_size) {
+            void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                mapped = true;
+                data = (const char*) p;
+                size = st.st_size;
+                pos = offset;
+            }
+        }
+    }
+}
+
+InputBuffer::~InputBuffer()
+{
+    if (mapped)
+        munmap((void*) data, size);
+}
+
+// Reads the next block once everything before it has been consumed. Returns
+// false at the end of the input. A mapped file is never refilled.
+bool InputBuffer::Refill()
 {
-    if (!input_buffer.empty())
+    if (mapped)
         return false;
-    else
-        return cin.eof();
+
+    if (block_buffer.empty())
+        block_buffer.resize(INPUT_BLOCK_SIZE);
+
+    // keep any unread bytes at the front of the block
+    size_t left = size - pos;
+    if (left > 0 && pos > 0)
+        copy(block_buffer.begin() + pos, block_buffer.begin() + size, block_buffer.begin());
+    size = left;
+    pos = 0;
+    if (size == block_buffer.size())
+        block_buffer.resize(2 * block_buffer.size());
+    data = &block_buffer[0];
+
+    while (true) {
+        ssize_t n = read(fd, &block_buffer[size], block_buffer.size() - size);
+        if (n > 0) {
+            size += n;
+            return true;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        return size > 0;
+    }
 }
 
-char InputBuffer::UngetChar(char c)
+const char* InputBuffer::PeekToEnd(size_t& len)
 {
-    if (c != EOF)
-        input_buffer.push_back(c);;
-    return c;
+    if (!mapped) {
+        if (pos > 0) {
+            copy(block_buffer.begin() + pos, block_buffer.begin() + size, block_buffer.begin());
+            size -= pos;
+            pos = 0;
+        }
+        if (block_buffer.empty())
+            block_buffer.resize(INPUT_BLOCK_SIZE);
+        while (true) {
+            if (size == block_buffer.size())
+                block_buffer.resize(2 * block_buffer.size());
+            ssize_t n = read(fd, &block_buffer[size], block_buffer.size() - size);
+            if (n > 0)
+                size += n;
+            else if (n < 0 && errno == EINTR)
+                continue;
+            else
+                break;
+        }
+        data = &block_buffer[0];
+    }
+    len = size - pos;
+    return data + pos;
 }
 
-void InputBuffer::GetChar(char& c)
+char InputBuffer::UngetChar(char c)
 {
-    if (!input_buffer.empty()) {
-        c = input_buffer.back();
-        input_buffer.pop_back();
-    } else {
-        cin.get(c);
+    if (c != EOF) {
+        // the common case just steps the cursor back over the byte
+        if (input_buffer.empty() && !eof && pos > 0 && data[pos-1] == c)
+            pos--;
+        else
+            input_buffer.push_back(c);
     }
+    return c;
 }
 
 string InputBuffer::UngetString(string s)
 {
-    for (int i = 0; i < s.size(); i++)
-        input_buffer.push_back(s[s.size()-i-1]);
+    for (size_t i = 0; i < s.size(); i++)
+        UngetChar(s[s.size()-i-1]);
     return s;
 }
@@ -1,19 +1,99 @@
-
 #ifndef __INPUT_BUFFER__H__
 #define __INPUT_BUFFER__H__
 
 #include <string>
 #include <vector>
+#include <cstddef>
 
+// InputBuffer reads a file descriptor, standard input by default, in bulk.
+// If it is a regular file it is mapped into memory, otherwise it is read in
+// large blocks. The descriptor stays owned by the caller. The lexer can
+// either use GetChar()/UngetChar() or scan directly through the Peek() and
+// Advance() cursor, which avoids a stream call per byte.
 class InputBuffer {
   public:
+    explicit InputBuffer(int fd = 0);
+    ~InputBuffer();
+
     void GetChar(char&);
     char UngetChar(char);
     std::string UngetString(std::string);
     bool EndOfInput();
 
+    // Returns the next unread bytes and stores how many there are in len.
+    // len is 0 only when the input is exhausted, which also sets EndOfInput().
+    const char* Peek(size_t& len);
+    // Consumes n bytes; n must not exceed the len returned by Peek()
+    void Advance(size_t n);
+    // Bytes left in the mapped file, or in the current block for a pipe
+    size_t Remaining() const { return size - pos; }
+    // Reads a pipe to its end, so that all of the unread input is one block,
+    // and returns it like Peek(). Nothing may have been pushed back.
+    const char* PeekToEnd(size_t& len);
+    // Bytes consumed so far, counted from the start of what PeekToEnd()
+    // returned or of the mapped file
+    size_t Offset() const { return pos - input_buffer.size(); }
+
   private:
-    std::vector<char> input_buffer;
+    InputBuffer(const InputBuffer&);
+    InputBuffer& operator=(const InputBuffer&);
+
+    bool Refill();
+
+    int fd;
+    bool mapped;
+    bool eof;                       // set after reading past the end, like cin.eof()
+    const char* data;               // mapped file or block_buffer
+    size_t size;
+    size_t pos;
+    std::vector<char> block_buffer;
+    std::vector<char> input_buffer; // characters pushed back, in reverse order
 };
 
+// GetChar() and EndOfInput() are called for every byte by the lexer, so they
+// are kept inline and only fall through to Refill() at the end of a block.
+inline bool InputBuffer::EndOfInput()
+{
+    if (!input_buffer.empty())
+        return false;
+    else
+        return eof;
+}
+
+inline void InputBuffer::GetChar(char& c)
+{
+    if (!input_buffer.empty()) {
+        c = input_buffer.back();
+        input_buffer.pop_back();
+    } else if (pos < size || Refill()) {
+        c = data[pos++];
+    } else {
+        c = '\0';
+        eof = true;
+    }
+}
+
+inline const char* InputBuffer::Peek(size_t& len)
+{
+    if (!input_buffer.empty()) {
+        len = 1;
+        return &input_buffer.back();
+    }
+    if (pos == size && !Refill()) {
+        len = 0;
+        eof = true;     // like a failed GetChar()
+        return data + pos;
+    }
+    len = size - pos;
+    return data + pos;
+}
+
+inline void InputBuffer::Advance(size_t n)
+{
+    if (!input_buffer.empty())
+        input_buffer.pop_back();
+    else
+        pos += n;
+}
+
 #endif  //__INPUT_BUFFER__H__
@@ -0,0 +1,62 @@
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "intern.h"
+
+using namespace std;
+
+#define INITIAL_SLOTS 256
+
+Interner::Interner() : slots(INITIAL_SLOTS, -1)
+{
+}
+
+// FNV-1a
+unsigned Interner::Hash(const char* s, size_t len)
+{
+    unsigned h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char) s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int Interner::Intern(const char* s, size_t len)
+{
+    unsigned h = Hash(s, len);
+    size_t mask = slots.size() - 1;
+    size_t i = h & mask;
+
+    while (slots[i] != -1) {
+        int id = slots[i];
+        if (hashes[id] == h && names[id].size() == len &&
+            memcmp(names[id].data(), s, len) == 0)
+            return id;
+        i = (i + 1) & mask;
+    }
+
+    int id = (int) names.size();
+    names.push_back(string(s, len));
+    hashes.push_back(h);
+    slots[i] = id;
+
+    // keep the load factor under one half
+    if (2 * names.size() > slots.size())
+        Grow();
+    return id;
+}
+
+void Interner::Grow()
+{
+    vector<int> bigger(2 * slots.size(), -1);
+    size_t mask = bigger.size() - 1;
+    for (int id = 0; id < (int) names.size(); id++) {
+        size_t i = hashes[id] & mask;
+        while (bigger[i] != -1)
+            i = (i + 1) & mask;
+        bigger[i] = id;
+    }
+    slots.swap(bigger);
+}
@@ -0,0 +1,29 @@
+#ifndef __INTERN__H__
+#define __INTERN__H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstddef>
+
+// Interner maps identifier spellings to small dense integer ids. Looking up
+// a name that is already interned does not allocate, so the lexer can hand
+// out ids instead of copying strings into every token.
+class Interner {
+  public:
+    Interner();
+
+    int Intern(const char* s, size_t len);
+    const std::string& Spelling(int id) const { return names[id]; }
+    int Size() const { return (int) names.size(); }
+
+  private:
+    static unsigned Hash(const char* s, size_t len);
+    void Grow();
+
+    std::deque<std::string> names;  // deque keeps references stable as it grows
+    std::vector<unsigned> hashes;
+    std::vector<int> slots;         // open addressing, -1 marks an empty slot
+};
+
+#endif  //__INTERN__H__
@@ -0,0 +1,167 @@
+#include <vector>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "jit.h"
+
+using namespace std;
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_X86_64 1
+#else
+#define JIT_X86_64 0
+#endif
+
+// each mapping holds the code of many polynomials
+#define JIT_CHUNK_SIZE (64 * 1024)
+
+JitCompiler::JitCompiler() : used(0), function_count(0)
+{
+}
+
+JitCompiler::~JitCompiler()
+{
+    for (size_t i = 0; i < chunks.size(); i++)
+        munmap(chunks[i].base, chunks[i].size);
+}
+
+bool JitCompiler::Supported()
+{
+    return JIT_X86_64;
+}
+
+// Copies code into the last chunk, or a new one if it does not fit. The
+// chunk is writable only while the copy is made.
+void* JitCompiler::Install(const vector<unsigned char>& code)
+{
+    size_t size = (code.size() + 15) & ~(size_t) 15;
+    if (chunks.empty() || used + size > chunks.back().size) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t chunk_size = size > JIT_CHUNK_SIZE ? (size + page - 1) / page * page : JIT_CHUNK_SIZE;
+        void* p = mmap(NULL, chunk_size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return NULL;
+        Chunk chunk = { (unsigned char*) p, chunk_size };
+        chunks.push_back(chunk);
+        used = 0;
+    }
+
+    Chunk& chunk = chunks.back();
+    if (mprotect(chunk.base, chunk.size, PROT_READ | PROT_WRITE) != 0)
+        return NULL;
+    unsigned char* entry = chunk.base + used;
+    memcpy(entry, &code[0], code.size());
+    mprotect(chunk.base, chunk.size, PROT_READ | PROT_EXEC);
+    __builtin___clear_cache((char*) entry, (char*) entry + code.size());
+    used += size;
+    return entry;
+}
+
+#if JIT_X86_64
+
+namespace {
+
+// x86-64 register numbers
+enum { EAX = 0, ECX = 1, EDX = 2, ESI = 6, EDI = 7, R8D = 8, R9D = 9 };
+
+const int argument_register[JIT_MAX_PARAMS] = { EDI, ESI, EDX, ECX, R8D, R9D };
+
+// Emits the handful of instructions polynomial code needs. Every slot of
+// the polynomial lives in the stack frame at rsp + 4 * slot.
+class Emitter {
+  public:
+    vector<unsigned char> code;
+
+    void Byte(int b) { code.push_back((unsigned char) b); }
+    void Imm32(int v)
+    {
+        for (int i = 0; i < 4; i++)
+            Byte((unsigned) v >> (8 * i));
+    }
+
+    // op reg, [rsp + disp32]
+    void StackOperand(int opcode, int reg, int slot)
+    {
+        if (reg >= 8)
+            Byte(0x44);                     // REX.R
+        Byte(opcode);
+        Byte(0x84 | ((reg & 7) << 3));      // mod=10, rm=100 (SIB)
+        Byte(0x24);                         // base=rsp, no index
+        Imm32(4 * slot);
+    }
+    void StoreSlot(int slot, int reg) { StackOperand(0x89, reg, slot); }
+    void LoadSlot(int reg, int slot)  { StackOperand(0x8B, reg, slot); }
+
+    void MoveImmediate(int reg, int v) { Byte(0xB8 + reg); Imm32(v); }
+    void Zero(int reg)                 { Byte(0x31); Byte(0xC0 | (reg << 3) | reg); }
+    void Multiply(int dst, int src)    { Byte(0x0F); Byte(0xAF); Byte(0xC0 | (dst << 3) | src); }
+    void Add(int dst, int src)         { Byte(0x01); Byte(0xC0 | (src << 3) | dst); }
+
+    void AdjustStack(int bytes)
+    {
+        if (bytes == 0)
+            return;
+        Byte(0x48);                         // REX.W
+        Byte(0x81);
+        Byte(bytes > 0 ? 0xC4 : 0xEC);      // add rsp / sub rsp
+        Imm32(bytes > 0 ? bytes : -bytes);
+    }
+    void Return() { Byte(0xC3); }
+};
+
+}  // namespace
+
+// The code keeps the running sum in eax and the running product of a term
+// in ecx. A power is applied by square-and-multiply on edx with the bits of
+// the exponent unrolled, which gives the same wrap-around result as
+// repeated multiplication.
+JitFunction JitCompiler::Compile(const CompiledPolynomial& p)
+{
+    if (p.param_count > JIT_MAX_PARAMS)
+        return NULL;
+
+    Emitter e;
+    int frame = (4 * (p.slot_count + 1) + 15) & ~15;
+    e.AdjustStack(-frame);
+    for (int i = 0; i < p.param_count; i++)
+        e.StoreSlot(i, argument_register[i]);
+
+    for (int s = 0; s < p.sum_count; s++) {
+        e.Zero(EAX);
+        for (int t = p.sum_begin[s]; t < p.sum_begin[s+1]; t++) {
+            e.MoveImmediate(ECX, p.coefficients[t]);
+            for (int f = p.term_begin[t]; f < p.term_begin[t+1]; f++) {
+                e.LoadSlot(EDX, p.factor_slot[f]);
+                for (unsigned bits = p.factor_exponent[f]; bits != 0; bits >>= 1) {
+                    if (bits & 1)
+                        e.Multiply(ECX, EDX);
+                    if (bits > 1)
+                        e.Multiply(EDX, EDX);
+                }
+            }
+            e.Add(EAX, ECX);
+        }
+        if (s < p.sum_count - 1)
+            e.StoreSlot(p.param_count + s, EAX);
+    }
+
+    e.AdjustStack(frame);
+    e.Return();
+
+    void* entry = Install(e.code);
+    if (entry == NULL)
+        return NULL;
+    function_count++;
+    return (JitFunction) entry;
+}
+
+#else
+
+JitFunction JitCompiler::Compile(const CompiledPolynomial&)
+{
+    return NULL;
+}
+
+#endif
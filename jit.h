@@ -0,0 +1,48 @@
+#ifndef __JIT__H__
+#define __JIT__H__
+
+#include <vector>
+#include <cstddef>
+
+#include "poly.h"
+
+// Native code for a polynomial takes its arguments in registers, following
+// the System V calling convention, and returns its value. Unused arguments
+// are passed as 0.
+typedef int (*JitFunction)(int, int, int, int, int, int);
+
+// polynomials with more parameters than this are left to the interpreter
+#define JIT_MAX_PARAMS 6
+
+// JitCompiler translates compiled polynomials to x86-64 machine code in
+// pages it maps itself. Each function is written while its pages are
+// writable and then made executable, never both at once. On other
+// architectures Compile() always returns NULL and evaluation stays in the
+// interpreter.
+class JitCompiler {
+  public:
+    JitCompiler();
+    ~JitCompiler();
+
+    static bool Supported();
+
+    // Returns native code for p, or NULL if p cannot be compiled
+    JitFunction Compile(const CompiledPolynomial& p);
+    int FunctionCount() const { return function_count; }
+
+  private:
+    JitCompiler(const JitCompiler&);
+    JitCompiler& operator=(const JitCompiler&);
+
+    void* Install(const std::vector<unsigned char>& code);
+
+    struct Chunk {
+        unsigned char* base;
+        size_t size;
+    };
+    std::vector<Chunk> chunks;
+    size_t used;            // bytes used in the last chunk
+    int function_count;
+};
+
+#endif  //__JIT__H__
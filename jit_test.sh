@@ -0,0 +1,61 @@
+#!/bin/bash
+
+# Runs every provided test through the interpreter and through the JIT,
+# with every polynomial compiled on its first evaluation, and checks that
+# the two outputs are identical. --stats reports how many polynomials the
+# JIT compiled, and the last check fails if it compiled none at all, since
+# then the comparisons above only ran the interpreter twice.
+
+if [ ! -d "./provided_tests" ]; then
+    echo "Error: tests directory not found!"
+    exit 1
+fi
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+let compiled=0
+
+mkdir -p ./output
+
+for test_file in $(find ./provided_tests -type f -name "*.txt" | sort); do
+    all=$((all+1))
+    name=`basename ${test_file} .txt`
+    folder_name="$(cut -d'/' -f3 <<<"${test_file}")"
+    interp_file=./output/${name}.interp
+    jit_file=./output/${name}.jit
+    stats_file=./output/${name}.stats
+
+    ./a.out < ${test_file} > ${interp_file}
+    ./a.out --jit --jit-threshold 0 --stats < ${test_file} > ${jit_file} 2> ${stats_file}
+    n=$(sed -n 's/^compiled \([0-9]*\) of .*/\1/p' ${stats_file})
+    compiled=$((compiled + ${n:-0}))
+
+    if cmp -s ${interp_file} ${jit_file}; then
+        count=$((count+1))
+        echo "${folder_name}/${name}: OK"
+    else
+        echo "${folder_name}/${name}: JIT output differs from the interpreter:"
+        echo "--------------------------------------------------------"
+        diff ${interp_file} ${jit_file}
+    fi
+    rm -f ${interp_file} ${jit_file} ${stats_file}
+done
+
+all=$((all+1))
+if [ ${compiled} -gt 0 ]; then
+    count=$((count+1))
+    echo "native code: OK (${compiled} polynomials compiled)"
+else
+    echo "native code: the JIT compiled no polynomials, so it was never tested"
+fi
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
@@ -0,0 +1,61 @@
+#!/bin/bash
+
+# Compiles polynomials with tens of thousands of terms under a memory and
+# time limit, so that compiling them stays close to linear in their size.
+# F = x^n + ... + x and G = sum of (i % 7 + 1) x^i y^(n-i) for i < n,
+# evaluated at x = y = 1.
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+
+mkdir -p ./output
+
+for n in 10000 50000; do
+    all=$((all+1))
+    program=./output/poly_${n}.txt
+    {
+        echo "TASKS"
+        echo "    2"
+        echo "POLY"
+        echo -n "    F = x"
+        for ((i = 2; i <= n; i++)); do echo -n " + x^$i"; done
+        echo ";"
+        echo -n "    G(x, y) = 2 x y^$((n-1))"
+        for ((i = 2; i < n; i++)); do echo -n " + $((i % 7 + 1)) x^$i y^$((n-i))"; done
+        echo ";"
+        echo "EXECUTE"
+        echo "    INPUT a;"
+        echo "    INPUT b;"
+        echo "    w = F(a);"
+        echo "    OUTPUT w;"
+        echo "    v = G(a, b);"
+        echo "    OUTPUT v;"
+        echo "INPUTS"
+        echo "    1 1"
+    } > ${program}
+
+    expected_g=0
+    for ((i = 1; i < n; i++)); do expected_g=$((expected_g + i % 7 + 1)); done
+    expected="$n $expected_g"
+
+    # 256 MB of address space and 10 seconds
+    output=$( (ulimit -v 262144; timeout 10 ./a.out < ${program}) | tr '\n' ' ' | sed 's/ $//')
+    if [ "${output}" = "${expected}" ]; then
+        count=$((count+1))
+        echo "poly_${n}: OK"
+    else
+        echo "poly_${n}: expected \"${expected}\", got \"${output}\""
+    fi
+    rm -f ${program}
+done
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
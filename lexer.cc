@@ -3,10 +3,12 @@
 #include <istream>
 #include <vector>
 #include <string>
-#include <cctype>
+#include <climits>
+#include <cstring>
 
 #include "lexer.h"
 #include "inputbuf.h"
+#include "charclass.h"
 
 using namespace std;
 
@@ -18,174 +20,288 @@ string reserved[] = { "END_OF_FILE",
 #define KEYWORDS_COUNT 6
 string keyword[] = { "POLY", "INPUT","TASKS", "EXECUTE", "OUTPUT","INPUTS"};
 
-void Token::Print()
+void Token::Print(const Interner& symbols)
 {
-    cout << "{" << this->lexeme << " , "
+    cout << "{";
+    if (this->token_type == ID)
+        cout << symbols.Spelling(this->symbol);
+    else if (this->token_type == NUM)
+        cout << this->value;
+    else if (this->token_type >= POLY && this->token_type <= INPUTS)
+        cout << reserved[(int) this->token_type];
+    cout << " , "
          << reserved[(int) this->token_type] << " , "
          << this->line_no << "}\n";
 }
 
 
 
-// The constructor function will get all token in the input and stores them in an
-// internal vector. This faciliates the implementation of peek()
-LexicalAnalyzer::LexicalAnalyzer()
+// Tokens are produced on demand: the lexer only keeps the few tokens the
+// parser has peeked at in a small ring buffer, so memory does not grow with
+// the input and parsing starts before the whole input has been read.
+LexicalAnalyzer::LexicalAnalyzer(int fd) : input(fd)
 {
     this->line_no = 1;
-    tmp.lexeme = "";
     tmp.line_no = 1;
     tmp.token_type = ERROR;
+    tmp.symbol = -1;
+    tmp.value = 0;
 
-    Token token = GetTokenMain();
-    index = 0;
+    window_start = 0;
+    window_count = 0;
+}
 
-    while (token.token_type != END_OF_FILE)
-    {
-        tokenList.push_back(token);     // push token into internal list
-        token = GetTokenMain();        // and get next token from standatd input
-    }
-    // pushes END_OF_FILE is not pushed on the token list
+// Lines are still counted, so tokens after the skipped text keep their line
+void LexicalAnalyzer::Skip(size_t n)
+{
+    size_t len;
+    const char* p = input.PeekToEnd(len);
+    for (size_t i = 0; i < n; i++)
+        line_no += p[i] == '\n';
+    input.Advance(n);
+}
 
+// Lexes tokens into the window until it holds at least count of them. Once
+// the input is exhausted GetTokenMain() keeps returning END_OF_FILE.
+void LexicalAnalyzer::FillWindow(int count)
+{
+    while (window_count < count) {
+        window[(window_start + window_count) & (LOOKAHEAD_WINDOW - 1)] = GetTokenMain();
+        window_count++;
+    }
 }
 
+// SkipSpace(), ScanNumber() and ScanIdOrKeyword() work directly on the input
+// cursor: each Peek() hands back a contiguous block and ClassRun() finds the
+// end of the run in it, so only tokens that straddle a block boundary need
+// another pass round the loop.
 bool LexicalAnalyzer::SkipSpace()
 {
-    char c;
     bool space_encountered = false;
+    size_t len;
+    const char* p = input.Peek(len);
 
-    input.GetChar(c);
-    line_no += (c == '\n');
-
-    while (!input.EndOfInput() && isspace(c)) {
-        space_encountered = true;
-        input.GetChar(c);
-        line_no += (c == '\n');
-    }
-
-    if (!input.EndOfInput()) {
-        input.UngetChar(c);
+    while (len > 0) {
+        size_t n = ClassRun(p, len, CC_SPACE, &line_no);
+        input.Advance(n);
+        space_encountered = space_encountered || n > 0;
+        if (n < len)
+            break;
+        p = input.Peek(len);
     }
     return space_encountered;
 }
 
-bool LexicalAnalyzer::IsKeyword(string s)
+// The six keywords differ in length or first letter, so the pair picks the
+// only keyword an identifier could be and a single compare settles it.
+TokenType LexicalAnalyzer::KeywordType(const char* s, size_t len)
 {
-    for (int i = 0; i < KEYWORDS_COUNT; i++) {
-        if (s == keyword[i]) {
-            return true;
-        }
+    TokenType t;
+    switch (len) {
+        case 4: t = POLY; break;
+        case 5: t = (s[0] == 'I') ? INPUT : TASKS; break;
+        case 6: t = (s[0] == 'I') ? INPUTS : OUTPUT; break;
+        case 7: t = EXECUTE; break;
+        default: return ID;
     }
-    return false;
+    return memcmp(s, keyword[t - 1].data(), len) == 0 ? t : ID;
 }
 
-TokenType LexicalAnalyzer::FindKeywordIndex(string s)
+// Converts eight ASCII digits to their value with three multiplies on one
+// 64-bit word (SIMD within a register). Assumes a little-endian load.
+static inline unsigned long long Parse8Digits(const char* p)
 {
-    for (int i = 0; i < KEYWORDS_COUNT; i++) {
-        if (s == keyword[i]) {
-            return (TokenType) (i + 1);
-        }
+    unsigned long long v;
+    memcpy(&v, p, 8);
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return v;
+}
+
+// Appends the n digits at p to v. Values that do not fit in a long saturate
+// and are then truncated to int, which is what the parser got from atoi()
+// on the lexeme before.
+static unsigned long long AccumulateDigits(unsigned long long v, const char* p, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        if (v > LONG_MAX / 100000000)
+            return (unsigned long long) LONG_MAX + 1;
+        v = v * 100000000 + Parse8Digits(p + i);
+    }
+    for (; i < n; i++) {
+        if (v > LONG_MAX / 10)
+            return (unsigned long long) LONG_MAX + 1;
+        v = v * 10 + (p[i] - '0');
     }
-    return ERROR;
+    return v;
 }
 
+static inline int DigitsValue(unsigned long long v)
+{
+    return (int) (v > LONG_MAX ? LONG_MAX : v);
+}
+
+// Numbers are decoded while they are scanned. A leading 0 is a number on
+// its own.
 Token LexicalAnalyzer::ScanNumber()
 {
-    char c;
+    size_t len;
+    const char* p = input.Peek(len);
 
-    input.GetChar(c);
-    if (isdigit(c)) {
-        if (c == '0') {
-            tmp.lexeme = "0";
-        } else {
-            tmp.lexeme = "";
-            while (!input.EndOfInput() && isdigit(c)) {
-                tmp.lexeme += c;
-                input.GetChar(c);
-            }
-            if (!input.EndOfInput()) {
-                input.UngetChar(c);
-            }
-        }
-        tmp.token_type = NUM;
-        tmp.line_no = line_no;
-        return tmp;
-    } else {
-        if (!input.EndOfInput()) {
-            input.UngetChar(c);
-        }
-        tmp.lexeme = "";
+    tmp.line_no = line_no;
+    if (len == 0 || !IsDigitChar(*p)) {
         tmp.token_type = ERROR;
-        tmp.line_no = line_no;
         return tmp;
     }
+    tmp.token_type = NUM;
+    if (*p == '0') {
+        input.Advance(1);
+        tmp.value = 0;
+        return tmp;
+    }
+
+    unsigned long long v = 0;
+    while (len > 0) {
+        size_t n = ClassRun(p, len, CC_DIGIT);
+        v = AccumulateDigits(v, p, n);
+        input.Advance(n);
+        if (n < len)
+            break;
+        p = input.Peek(len);
+    }
+    tmp.value = DigitsValue(v);
+    return tmp;
 }
 
 
+// Identifiers that lie inside one block are interned straight from the
+// input; only one that runs into the end of a block is copied to scratch.
 Token LexicalAnalyzer::ScanIdOrKeyword()
 {
-    char c;
-    input.GetChar(c);
+    size_t len;
+    const char* p = input.Peek(len);
 
-    if (isalpha(c)) {
-        tmp.lexeme = "";
-        while (!input.EndOfInput() && isalnum(c)) {
-            tmp.lexeme += c;
-            input.GetChar(c);
-        }
-        if (!input.EndOfInput()) {
-            input.UngetChar(c);
+    if (len == 0 || !IsAlphaChar(*p)) {
+        tmp.token_type = ERROR;
+        return tmp;
+    }
+
+    const char* name = p;
+    size_t name_len = ClassRun(p, len, CC_ALNUM);
+    if (name_len == len) {
+        scratch.assign(p, name_len);
+        input.Advance(name_len);
+        for (p = input.Peek(len); len > 0; p = input.Peek(len)) {
+            size_t n = ClassRun(p, len, CC_ALNUM);
+            scratch.append(p, n);
+            input.Advance(n);
+            if (n < len)
+                break;
         }
-        tmp.line_no = line_no;
-        if (IsKeyword(tmp.lexeme))
-            tmp.token_type = FindKeywordIndex(tmp.lexeme);
-        else
-            tmp.token_type = ID;
+        name = scratch.data();
+        name_len = scratch.size();
     } else {
-        if (!input.EndOfInput()) {
-            input.UngetChar(c);
-        }
-        tmp.lexeme = "";
-        tmp.token_type = ERROR;
+        input.Advance(name_len);
     }
+
+    tmp.line_no = line_no;
+    tmp.token_type = KeywordType(name, name_len);
+    if (tmp.token_type == ID)
+        tmp.symbol = symbols.Intern(name, name_len);
     return tmp;
 }
 
-// GetToken() accesses tokens from the tokenList that is populated when a 
-// lexer object is instantiated
-Token LexicalAnalyzer::GetToken()
+// ScanNumberList() decodes everything after the INPUTS keyword in one pass,
+// appending the numbers to values without building a token for each. It
+// splits numbers exactly as ScanNumber() does (a leading 0 is a number on
+// its own) and returns false wherever the token parser would have found a
+// syntax error: no number at all, or anything other than numbers and
+// whitespace before the end of the input. The numbers ahead of the bad
+// input are still appended, as parse_num_list() used to store them.
+bool LexicalAnalyzer::ScanNumberList(vector<int>& values)
 {
-    Token token;
-    if (index == tokenList.size()){       // return end of file if
-        token.lexeme = "";                // index is too large
-        token.line_no = line_no;
-        token.token_type = END_OF_FILE;
+    size_t first = values.size();
+
+    // tokens the parser has already peeked at
+    while (window_count > 0) {
+        Token t = GetToken();
+        if (t.token_type != NUM)
+            return t.token_type == END_OF_FILE && values.size() > first;
+        values.push_back(t.value);
     }
-    else{
-        token = tokenList[index];
-        index = index + 1;
+
+    // most inputs are short numbers, one separator each
+    values.reserve(values.size() + input.Remaining() / 4);
+
+    unsigned long long v = 0;
+    bool in_number = false;     // a number runs on into the next block
+    size_t len;
+    const char* p;
+    for (p = input.Peek(len); len > 0; p = input.Peek(len)) {
+        size_t i = 0;
+        while (i < len) {
+            if (!in_number) {
+                i += ClassRun(p + i, len - i, CC_SPACE, &line_no);
+                if (i == len)
+                    break;
+                if (!IsDigitChar(p[i])) {
+                    input.Advance(i);
+                    return false;
+                }
+                if (p[i] == '0') {
+                    values.push_back(0);
+                    i++;
+                    continue;
+                }
+                in_number = true;
+                v = 0;
+            }
+            size_t n = ClassRun(p + i, len - i, CC_DIGIT);
+            v = AccumulateDigits(v, p + i, n);
+            i += n;
+            if (i < len) {
+                values.push_back(DigitsValue(v));
+                in_number = false;
+            }
+        }
+        input.Advance(len);
     }
+    if (in_number)
+        values.push_back(DigitsValue(v));
+    return values.size() > first;
+}
+
+// GetToken() returns the oldest token in the lookahead window, lexing a new
+// one if the parser has not peeked ahead
+Token LexicalAnalyzer::GetToken()
+{
+    FillWindow(1);
+    Token token = window[window_start];
+    window_start = (window_start + 1) & (LOOKAHEAD_WINDOW - 1);
+    window_count--;
     return token;
 }
 
 
 
-// peek requires that the argument "howFar" be positive.
+// peek requires that the argument "howFar" be positive and no larger than
+// MAX_LOOKAHEAD.
 Token LexicalAnalyzer::peek(int howFar)
 {
     if (howFar <= 0) {      // peeking backward or in place is not allowed
         cout << "LexicalAnalyzer:peek:Error: non positive argument\n";
         exit(-1);
     } 
+    if (howFar > MAX_LOOKAHEAD) {   // the window only holds MAX_LOOKAHEAD tokens
+        cout << "LexicalAnalyzer:peek:Error: argument larger than MAX_LOOKAHEAD\n";
+        exit(-1);
+    }
 
-    int peekIndex = index + howFar - 1;
-    if (peekIndex > (tokenList.size()-1)) { // if peeking too far
-        Token token;                        // return END_OF_FILE
-        token.lexeme = "";
-        token.line_no = line_no;
-        token.token_type = END_OF_FILE;
-        return token;
-    } else
-        return tokenList[peekIndex];
+    FillWindow(howFar);
+    return window[(window_start + howFar - 1) & (LOOKAHEAD_WINDOW - 1)];
 }
 
 Token LexicalAnalyzer::GetTokenMain()
@@ -193,7 +309,8 @@ Token LexicalAnalyzer::GetTokenMain()
     char c;
 
     SkipSpace();
-    tmp.lexeme = "";
+    tmp.symbol = -1;
+    tmp.value = 0;
     tmp.line_no = line_no;
     tmp.token_type = END_OF_FILE;
     if (!input.EndOfInput())
@@ -211,10 +328,10 @@ Token LexicalAnalyzer::GetTokenMain()
         case ')': tmp.token_type = RPAREN;    return tmp;
         case ',': tmp.token_type = COMMA;     return tmp;
         default:
-            if (isdigit(c)) {
+            if (IsDigitChar(c)) {
                 input.UngetChar(c);
                 return ScanNumber();
-            } else if (isalpha(c)) {
+            } else if (IsAlphaChar(c)) {
                 input.UngetChar(c);
                 return ScanIdOrKeyword();
             } else if (input.EndOfInput())
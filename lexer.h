@@ -6,6 +6,7 @@
 #include <string>
 
 #include "inputbuf.h"
+#include "intern.h"
 
 // ------- token types -------------------
 
@@ -16,32 +17,61 @@ typedef enum { END_OF_FILE = 0,
     PLUS, MINUS, SEMICOLON, ERROR,
     } TokenType;
 
+// Tokens are small and trivially copyable. ID tokens carry the interned id
+// of their name and NUM tokens carry their decoded value, so passing tokens
+// around never copies a string.
 class Token {
   public:
-    void Print();
+    void Print(const Interner&);
 
-    std::string lexeme;
     TokenType token_type;
     int line_no;
+    int symbol;     // ID: interned name, otherwise -1
+    int value;      // NUM: value of the number, otherwise 0
 };
 
+// The parser never looks further ahead than peek(2)
+#define MAX_LOOKAHEAD 2
+// ring buffer capacity, a power of two no smaller than MAX_LOOKAHEAD
+#define LOOKAHEAD_WINDOW 4
+
 class LexicalAnalyzer {
   public:
     Token GetToken();
     Token peek(int);
-    LexicalAnalyzer();
+    // reads the program from fd, standard input by default
+    explicit LexicalAnalyzer(int fd = 0);
+
+    // The unread program text, read to its end; only valid before the
+    // first token. Skip() then moves past n bytes of it without lexing.
+    const char* Source(size_t& len) { return input.PeekToEnd(len); }
+    void Skip(size_t n);
+    // bytes of Source() consumed, once no tokens are waiting in the window
+    size_t Offset() const { return input.Offset(); }
+    bool WindowEmpty() const { return window_count == 0; }
+
+    // decodes the number list that follows the INPUTS keyword
+    bool ScanNumberList(std::vector<int>& values);
+
+    // spelling of an interned ID, and the id of a name
+    const std::string& Name(int symbol) const { return symbols.Spelling(symbol); }
+    int Intern(const std::string& name) { return symbols.Intern(name.data(), name.size()); }
+    const Interner& Symbols() const { return symbols; }
 
   private:
-    std::vector<Token> tokenList;
+    Token window[LOOKAHEAD_WINDOW];   // tokens lexed ahead but not consumed
+    int window_start;
+    int window_count;
+    void FillWindow(int count);
     Token GetTokenMain();
     int line_no;
-    int index;
     Token tmp;
     InputBuffer input;
+    Interner symbols;
+    std::string scratch;    // reused spelling buffer for identifiers
 
     bool SkipSpace();
-    bool IsKeyword(std::string);
-    TokenType FindKeywordIndex(std::string);
+    TokenType KeywordType(const char*, size_t);
     Token ScanNumber();
     Token ScanIdOrKeyword();
 };
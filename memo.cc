@@ -0,0 +1,81 @@
+#include <vector>
+#include <cstring>
+
+#include "memo.h"
+
+using namespace std;
+
+#define MEMO_MASK ((1u << MEMO_CAPACITY_BITS) - 1)
+
+MemoCache::MemoCache(int arity)
+    : arity(arity), stride(arity + 2), enabled(true), hits(0), misses(0), sample_hits(0), sample_lookups(0)
+{
+}
+
+unsigned MemoCache::Hash(const int* key) const
+{
+    unsigned h = 2166136261u;
+    for (int i = 0; i < arity; i++)
+        h = (h ^ (unsigned) key[i]) * 0x9E3779B1u;
+    h ^= h >> 15;
+    return h | 1;       // never 0, which marks an empty entry
+}
+
+void MemoCache::Sample()
+{
+    if (sample_hits * MEMO_MIN_HIT_RATIO < sample_lookups) {
+        enabled = false;
+        vector<int>().swap(entries);    // nothing reads it again
+    }
+    sample_hits = 0;
+    sample_lookups = 0;
+}
+
+bool MemoCache::Lookup(const int* key, int& value)
+{
+    unsigned h = Hash(key);
+    bool found = false;
+    for (unsigned i = 0; i < MEMO_PROBE_LIMIT && !entries.empty(); i++) {
+        const int* e = &entries[(size_t) ((h + i) & MEMO_MASK) * stride];
+        if (e[0] == 0)
+            break;
+        if ((unsigned) e[0] == h && memcmp(e + 2, key, arity * sizeof(int)) == 0) {
+            value = e[1];
+            found = true;
+            break;
+        }
+    }
+
+    if (found) {
+        hits++;
+        sample_hits++;
+    } else {
+        misses++;
+    }
+    if (++sample_lookups == MEMO_SAMPLE)
+        Sample();
+    return found;
+}
+
+void MemoCache::Insert(const int* key, int value)
+{
+    // the lookup that missed may have just disabled the cache
+    if (!enabled)
+        return;
+    // the table is only allocated once something is stored in it
+    if (entries.empty())
+        entries.resize((size_t) stride << MEMO_CAPACITY_BITS, 0);
+
+    unsigned h = Hash(key);
+    int* e = &entries[(size_t) (h & MEMO_MASK) * stride];
+    for (unsigned i = 0; i < MEMO_PROBE_LIMIT; i++) {
+        int* probe = &entries[(size_t) ((h + i) & MEMO_MASK) * stride];
+        if (probe[0] == 0) {
+            e = probe;
+            break;
+        }
+    }
+    e[0] = (int) h;
+    e[1] = value;
+    memcpy(e + 2, key, arity * sizeof(int));
+}
@@ -0,0 +1,49 @@
+#ifndef __MEMO__H__
+#define __MEMO__H__
+
+#include <vector>
+
+// log2 of the number of entries in each cache
+#define MEMO_CAPACITY_BITS 12
+// entries looked at before an insert replaces the first one probed
+#define MEMO_PROBE_LIMIT 8
+// lookups between two checks of the hit rate
+#define MEMO_SAMPLE 1024
+// the cache turns itself off when fewer than 1 in MEMO_MIN_HIT_RATIO
+// lookups of a sample hit
+#define MEMO_MIN_HIT_RATIO 8
+
+// MemoCache remembers the results of one polynomial keyed by its argument
+// values. It is an open-addressing table of fixed size, so it never grows;
+// an insert into a full neighbourhood overwrites an older entry. Every
+// MEMO_SAMPLE lookups the hit rate of the sample is checked, and a cache
+// that does not pay for itself frees its table and disables itself for the
+// rest of the run.
+class MemoCache {
+  public:
+    explicit MemoCache(int arity);
+
+    // key holds arity argument values
+    bool Lookup(const int* key, int& value);
+    void Insert(const int* key, int value);
+
+    bool Enabled() const { return enabled; }
+    long Hits() const { return hits; }
+    long Misses() const { return misses; }
+
+  private:
+    unsigned Hash(const int* key) const;
+    void Sample();
+
+    int arity;
+    int stride;                 // ints per entry: hash, value, key
+    std::vector<int> entries;   // a hash of 0 marks an empty entry; empty until the first
+                                // insert and once disabled
+    bool enabled;
+    long hits;
+    long misses;
+    long sample_hits;
+    long sample_lookups;
+};
+
+#endif  //__MEMO__H__
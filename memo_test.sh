@@ -0,0 +1,112 @@
+#!/bin/bash
+
+# Checks --memo. Every provided test must print the same with --memo, alone
+# and with the JIT, as without it. Generated programs then pin the counts
+# that --stats reports: a polynomial called with a few argument values
+# over and over keeps its cache, and one whose sample of MEMO_SAMPLE
+# lookups hits less than 1 in MEMO_MIN_HIT_RATIO times turns its cache off.
+
+if [ ! -d "./provided_tests" ]; then
+    echo "Error: tests directory not found!"
+    exit 1
+fi
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+
+mkdir -p ./output
+
+for test_file in $(find ./provided_tests -type f -name "*.txt" | sort); do
+    all=$((all+1))
+    name=`basename ${test_file} .txt`
+    folder_name="$(cut -d'/' -f3 <<<"${test_file}")"
+    plain_file=./output/${name}.plain
+    memo_file=./output/${name}.memo
+    memo_jit_file=./output/${name}.memo_jit
+
+    ./a.out < ${test_file} > ${plain_file}
+    ./a.out --memo < ${test_file} > ${memo_file}
+    ./a.out --memo --jit --jit-threshold 0 < ${test_file} > ${memo_jit_file}
+
+    if cmp -s ${plain_file} ${memo_file} && cmp -s ${plain_file} ${memo_jit_file}; then
+        count=$((count+1))
+        echo "${folder_name}/${name}: OK"
+    else
+        echo "${folder_name}/${name}: --memo output differs from the plain run:"
+        echo "--------------------------------------------------------"
+        diff ${plain_file} ${memo_file}
+        diff ${plain_file} ${memo_jit_file}
+    fi
+    rm -f ${plain_file} ${memo_file} ${memo_jit_file}
+done
+
+# Writes a program that evaluates F once for each of its arguments, in order
+generate()
+{
+    echo "TASKS"
+    echo "    2"
+    echo "POLY"
+    echo "    F(x) = 3 x^2 - x + 7;"
+    echo "EXECUTE"
+    for x in "$@"; do
+        echo "    w = F($x);"
+        echo "    OUTPUT w;"
+    done
+    echo "INPUTS"
+    echo "    1"
+}
+
+# runs program with the options in $3.. and checks that it prints what it
+# prints without them and that --stats reports the line expected
+check()
+{
+    all=$((all+1))
+    local name=$1 expected=$2 program=./output/memo_$1.txt
+    shift 2
+    local plain=$(./a.out < ${program})
+    local memo=$(./a.out "$@" --stats < ${program} 2> ./output/memo_${name}.stats)
+    local stats=$(<./output/memo_${name}.stats)
+    if [ "${memo}" != "${plain}" ]; then
+        echo "memo_${name}: output with $* differs from the plain run"
+    elif ! grep -qxF "${expected}" <<<"${stats}"; then
+        echo "memo_${name}: expected \"${expected}\" from --stats, got:"
+        echo "${stats}"
+    else
+        count=$((count+1))
+        echo "memo_${name}: OK"
+    fi
+    rm -f ./output/memo_${name}.stats
+}
+
+# 2000 evaluations over 10 argument values: only the first of each misses
+generate $(for ((i = 0; i < 2000; i++)); do echo $((i % 10)); done) > ./output/memo_repeat.txt
+check repeat "memo F: 1990 hits, 10 misses" --memo
+# the JIT compiles F on its first evaluation even though the cache answers
+# nearly all of them
+check repeat "compiled 1 of 1 polynomials to native code" --memo --jit --jit-threshold 0
+check repeat "memo F: 1990 hits, 10 misses" --memo --jit --jit-threshold 0
+rm -f ./output/memo_repeat.txt
+
+# every argument is new, so the first sample has no hits at all
+generate $(seq 1 2000) > ./output/memo_distinct.txt
+check distinct "memo F: 0 hits, 1024 misses, disabled" --memo
+rm -f ./output/memo_distinct.txt
+
+# one sample of 1024 lookups with 127 hits, just under 1 in 8, then with 128
+generate 0 $(for ((i = 0; i < 127; i++)); do echo 0; done) $(seq 1 896) > ./output/memo_127.txt
+check 127 "memo F: 127 hits, 897 misses, disabled" --memo
+rm -f ./output/memo_127.txt
+generate 0 $(for ((i = 0; i < 128; i++)); do echo 0; done) $(seq 1 895) > ./output/memo_128.txt
+check 128 "memo F: 128 hits, 896 misses" --memo
+rm -f ./output/memo_128.txt
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
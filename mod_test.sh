@@ -0,0 +1,176 @@
+#!/bin/bash
+
+# Checks --mod P against residues worked out independently. The program is
+# the one exact_test.sh checks, whose values run far past 64 bits and are
+# negative at times, so every residue comes from a reduction rather than a
+# plain int. Odd moduli take the Montgomery path and even ones the 128-bit
+# division path. Moduli outside [2, 2^63), or that are not numbers, must
+# be rejected with the usage message before anything runs.
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+
+mkdir -p ./output
+
+program=./output/mod_program.txt
+cat > ${program} <<'EOF'
+TASKS
+    2
+POLY
+    F(x) = x^2 + 1;
+    G(x, y) = x y - 3 y;
+    H(x) = x^5 + x^4 + x^3 + x^2 + x + 1;
+    K(x) = x - x^4;
+    D(x) = (x + 1)^6 - x^6;
+    M(x) = x^2 - 1;
+    T(x) = x^4;
+    S(x, y) = x^2 - y;
+EXECUTE
+    INPUT a;
+    INPUT b;
+    INPUT c;
+    INPUT d;
+    INPUT e;
+    w = F(a);
+    OUTPUT w;
+    w = F(b);
+    OUTPUT w;
+    w = G(c, b);
+    OUTPUT w;
+    w = M(e);
+    OUTPUT w;
+    w = M(d);
+    OUTPUT w;
+    w = T(e);
+    OUTPUT w;
+    w = T(b);
+    OUTPUT w;
+    w = H(b);
+    OUTPUT w;
+    w = K(b);
+    OUTPUT w;
+    w = D(b);
+    OUTPUT w;
+    t = F(b);
+    v = F(t);
+    OUTPUT v;
+    s = S(t, v);
+    OUTPUT s;
+    s = G(s, v);
+    OUTPUT s;
+INPUTS
+    65536 4294967295 1 3037000500 3037000499
+EOF
+
+# checks that the program prints $2 mod $1
+check()
+{
+    all=$((all+1))
+    local p=$1 expected=$2
+    local output=$(./a.out --mod ${p} < ${program})
+    if [ "${output}" = "${expected}" ]; then
+        count=$((count+1))
+        echo "mod ${p}: OK"
+    else
+        echo "mod ${p}: output does not match expected:"
+        echo "--------------------------------------------------------"
+        diff <(echo "${expected}") <(echo "${output}")
+    fi
+}
+
+# Montgomery form, the usual prime
+check 1000000007 "294967269
+992409481
+410065473
+362645238
+436646195
+448786145
+99734417
+600903771
+195232850
+594219463
+84553365
+1000000006
+661786547"
+# Montgomery form, the largest prime below 2^63
+check 9223372036854775783 "4294967297
+9223372028264841243
+9223372028264841193
+9223372030926249000
+145474216
+7477313694326948175
+9223371160681450200
+12253541685188
+880468292878
+68745246501525
+9223371143501581120
+9223372036854775782
+3573412778652"
+# plain reduction, 2^32
+check 4294967296 "1
+2
+2
+2661407784
+145474191
+1156087441
+1
+0
+4294967294
+4294967295
+5
+4294967295
+4294967276"
+# plain reduction, a small power of 2
+check 1024 "1
+2
+2
+40
+655
+657
+1
+0
+1022
+1023
+5
+1023
+1004"
+# plain reduction, the smallest modulus
+check 2 "1
+0
+0
+0
+1
+1
+1
+0
+0
+1
+1
+1
+0"
+
+# 1 and 2^63 are just outside the range; -5 would wrap to a huge modulus
+for p in 0 1 9223372036854775808 18446744073709551617 -5 abc 12x ""; do
+    all=$((all+1))
+    ./a.out --mod "${p}" < ${program} > ./output/mod_invalid.output 2> ./output/mod_invalid.stderr
+    status=$?
+    if [ ${status} -eq 2 ] && [ ! -s ./output/mod_invalid.output ] && grep -q "^usage:" ./output/mod_invalid.stderr; then
+        count=$((count+1))
+        echo "mod \"${p}\" rejected: OK"
+    else
+        echo "mod \"${p}\": expected the usage message and exit status 2, got status ${status}"
+    fi
+    rm -f ./output/mod_invalid.output ./output/mod_invalid.stderr
+done
+rm -f ${program}
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
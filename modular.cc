@@ -0,0 +1,117 @@
+#include <vector>
+#include <algorithm>
+
+#include "modular.h"
+
+using namespace std;
+
+Montgomery::Montgomery(unsigned long long p) : p(p)
+{
+    // Newton's iteration doubles the correct low bits of 1/p each step,
+    // starting from the 3 that p itself gets right
+    unsigned long long inv = p;
+    for (int i = 0; i < 5; i++)
+        inv *= 2 - p * inv;
+    p_inv = 0 - inv;
+
+    unsigned long long r = (unsigned long long) (((unsigned __int128) 1 << 64) % p);
+    r2 = (unsigned long long) ((unsigned __int128) r * r % p);
+}
+
+ModularMachine::ModularMachine(const vector<const ExactPolynomial*>& polys, unsigned long long p)
+    : polys(polys), p(p), coefficients(polys.size())
+{
+    size_t size = 0;
+    for (size_t i = 0; i < polys.size(); i++)
+        size = max(size, (size_t) (polys[i]->param_count + polys[i]->sum_count));
+    table.resize(size);
+}
+
+// base^exponent by squaring, for exponents > 0
+template <typename Modulus>
+static unsigned long long Power(const Modulus& modulus, unsigned long long base, unsigned exponent)
+{
+    unsigned long long result = base;
+    int bit = 31 - __builtin_clz(exponent);
+    while (bit-- > 0) {
+        result = modulus.Multiply(result, result);
+        if ((exponent >> bit) & 1)
+            result = modulus.Multiply(result, base);
+    }
+    return result;
+}
+
+template <typename Modulus>
+unsigned long long ModularMachine::Evaluate(const Modulus& modulus, int poly, const int* args, int argc,
+                                            const unsigned long long* mem)
+{
+    const ExactPolynomial& p = *polys[poly];
+    const unsigned long long* c = coefficients[poly].data();
+    unsigned long long* t = table.data();
+    for (int i = 0; i < p.param_count; i++)
+        t[i] = i < argc ? mem[args[i]] : 0;
+
+    for (int s = 0; s < p.sum_count; s++) {
+        unsigned long long sum = 0;
+        for (int term = p.sum_begin[s]; term < p.sum_begin[s + 1]; term++) {
+            unsigned long long product = c[term];
+            for (int f = p.term_begin[term]; f < p.term_begin[term + 1]; f++) {
+                unsigned long long base = t[p.factor_slot[f]];
+                int e = p.factor_exponent[f];
+                product = modulus.Multiply(product, e == 1 ? base : Power(modulus, base, e));
+            }
+            sum = modulus.Add(sum, product);
+        }
+        t[p.param_count + s] = sum;
+    }
+    return t[p.param_count + p.sum_count - 1];
+}
+
+// Values are kept in the form of the modulus, and only turned back into
+// plain residues for OUTPUT. 0 is 0 in every form. Literals and inputs are
+// taken as unsigned, as ExactMachine does.
+template <typename Modulus>
+void ModularMachine::RunWith(const Modulus& modulus, const Bytecode& bytecode, int slot_count,
+                             const vector<int>& inputs, OutputSink& out)
+{
+    for (size_t i = 0; i < polys.size(); i++) {
+        coefficients[i].clear();
+        for (size_t term = 0; term < polys[i]->coefficients.size(); term++) {
+            long long c = polys[i]->coefficients[term] % (long long) p;
+            coefficients[i].push_back(modulus.ToForm(c < 0 ? c + p : c));
+        }
+    }
+
+    vector<unsigned long long> mem(max(slot_count, 1));
+    size_t next_input = 0;
+    for (const int* pc = bytecode.Code(); ; ) {
+        switch (*pc) {
+            case OP_INPUT:
+                mem[pc[1]] = next_input < inputs.size() ? modulus.ToForm((unsigned) inputs[next_input++]) : 0;
+                pc += 2;
+                break;
+            case OP_OUTPUT:
+                out << (unsigned long) modulus.FromForm(mem[pc[1]]) << '\n';
+                pc += 2;
+                break;
+            case OP_CONST:
+                mem[pc[1]] = modulus.ToForm((unsigned) pc[2]);
+                pc += 3;
+                break;
+            case OP_EVAL:
+                mem[pc[2]] = Evaluate(modulus, pc[1], pc + 4, pc[3], mem.data());
+                pc += 4 + pc[3];
+                break;
+            default:
+                return;
+        }
+    }
+}
+
+void ModularMachine::Run(const Bytecode& bytecode, int slot_count, const vector<int>& inputs, OutputSink& out)
+{
+    if (p & 1)
+        RunWith(Montgomery(p), bytecode, slot_count, inputs, out);
+    else
+        RunWith(DivisionModulus(p), bytecode, slot_count, inputs, out);
+}
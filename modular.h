@@ -0,0 +1,92 @@
+#ifndef __MODULAR__H__
+#define __MODULAR__H__
+
+#include <vector>
+
+#include "exact.h"
+#include "vm.h"
+
+// Montgomery multiplication modulo an odd p < 2^63, with R = 2^64. Values
+// are kept as a R mod p, so a product needs two 64x64 multiplies and no
+// division.
+class Montgomery {
+  public:
+    explicit Montgomery(unsigned long long p);
+
+    unsigned long long Modulus() const { return p; }
+    unsigned long long ToForm(unsigned long long a) const { return Multiply(a % p, r2); }
+    unsigned long long FromForm(unsigned long long a) const { return Reduce(a); }
+    unsigned long long Multiply(unsigned long long a, unsigned long long b) const
+    {
+        return Reduce((unsigned __int128) a * b);
+    }
+    unsigned long long Add(unsigned long long a, unsigned long long b) const
+    {
+        unsigned long long s = a + b;       // p < 2^63, so this does not wrap
+        return s >= p ? s - p : s;
+    }
+
+  private:
+    // t / R mod p, for t < p R
+    unsigned long long Reduce(unsigned __int128 t) const
+    {
+        unsigned long long m = (unsigned long long) t * p_inv;
+        unsigned long long r = (unsigned long long) ((t + (unsigned __int128) m * p) >> 64);
+        return r >= p ? r - p : r;
+    }
+
+    unsigned long long p;
+    unsigned long long p_inv;       // -1/p mod 2^64
+    unsigned long long r2;          // R^2 mod p
+};
+
+// Plain reduction with a 128-bit remainder, for the even moduli Montgomery
+// form can not handle. Values are kept as they are.
+class DivisionModulus {
+  public:
+    explicit DivisionModulus(unsigned long long p) : p(p) {}
+
+    unsigned long long Modulus() const { return p; }
+    unsigned long long ToForm(unsigned long long a) const { return a % p; }
+    unsigned long long FromForm(unsigned long long a) const { return a; }
+    unsigned long long Multiply(unsigned long long a, unsigned long long b) const
+    {
+        return (unsigned long long) ((unsigned __int128) a * b % p);
+    }
+    unsigned long long Add(unsigned long long a, unsigned long long b) const
+    {
+        unsigned long long s = a + b;
+        return s >= p ? s - p : s;
+    }
+
+  private:
+    unsigned long long p;
+};
+
+// ModularMachine runs Bytecode the way VirtualMachine does, but with every
+// value a residue mod p, so OUTPUT prints a number in [0, p). It evaluates
+// the exact form of each polynomial, whose coefficients are reduced mod p
+// once, up front. Powers are computed by squaring, so large exponents cost
+// their bit length in multiplies. p must be in [2, 2^63).
+class ModularMachine {
+  public:
+    ModularMachine(const std::vector<const ExactPolynomial*>& polys, unsigned long long p);
+
+    // Inputs past the end of inputs read as 0
+    void Run(const Bytecode& bytecode, int slot_count, const std::vector<int>& inputs, OutputSink& out);
+
+  private:
+    template <typename Modulus>
+    void RunWith(const Modulus& modulus, const Bytecode& bytecode, int slot_count, const std::vector<int>& inputs,
+                 OutputSink& out);
+    template <typename Modulus>
+    unsigned long long Evaluate(const Modulus& modulus, int poly, const int* args, int argc,
+                                const unsigned long long* mem);
+
+    std::vector<const ExactPolynomial*> polys;
+    unsigned long long p;
+    std::vector<std::vector<unsigned long long> > coefficients;     // of each polynomial, in the modulus' form
+    std::vector<unsigned long long> table;      // parameters and sum values while evaluating
+};
+
+#endif  //__MODULAR__H__
@@ -0,0 +1,104 @@
+#include <memory>
+#include <string>
+#include <climits>
+
+#include "number.h"
+
+using namespace std;
+
+Number Number::FromWide(__int128 v)
+{
+    if (v >= LLONG_MIN && v <= LLONG_MAX)
+        return Number((long long) v);
+    Number n;
+    n.width = WIDE;
+    n.wide = v;
+    return n;
+}
+
+Number Number::FromBig(const BigInt& v)
+{
+    __int128 w;
+    if (v.ToWide(w))
+        return FromWide(w);
+    Number n;
+    n.width = BIG;
+    n.big = make_shared<const BigInt>(v);
+    return n;
+}
+
+Number Number::AddSlow(const Number& a, const Number& b)
+{
+    __int128 r;
+    if (a.width != BIG && b.width != BIG && !__builtin_add_overflow(a.Wide(), b.Wide(), &r))
+        return FromWide(r);
+    return FromBig(BigInt::Add(a.Big(), b.Big()));
+}
+
+Number Number::MultiplySlow(const Number& a, const Number& b)
+{
+    __int128 r;
+    if (a.width != BIG && b.width != BIG && !__builtin_mul_overflow(a.Wide(), b.Wide(), &r))
+        return FromWide(r);
+    return FromBig(BigInt::Multiply(a.Big(), b.Big()));
+}
+
+Number Number::Power(const Number& base, int exponent)
+{
+    if (exponent <= 0)
+        return Number(1);
+    if (exponent == 1)
+        return base;
+
+    // on 64-bit values, until a multiply overflows
+    unsigned e = exponent;
+    if (base.width == SMALL) {
+        long long b = base.small, result = 1;
+        if (b == 0 || b == 1)
+            return base;
+        if (b == -1)
+            return Number(e & 1 ? -1 : 1);
+        for (;;) {
+            if ((e & 1) && __builtin_mul_overflow(result, b, &result))
+                break;
+            e >>= 1;
+            if (e == 0)
+                return Number(result);
+            if (__builtin_mul_overflow(b, b, &b))
+                break;
+        }
+    }
+
+    Number result(1), b = base;
+    for (e = exponent; e != 0; e >>= 1) {
+        if (e & 1)
+            result = result * b;
+        if (e > 1)
+            b = b * b;
+    }
+    return result;
+}
+
+string Number::ToString() const
+{
+    if (width == BIG)
+        return big->ToString();
+    __int128 v = Wide();
+    unsigned __int128 m = v < 0 ? (unsigned __int128) 0 - (unsigned __int128) v : (unsigned __int128) v;
+    char digits[48];
+    char* p = digits + sizeof(digits);
+    do {
+        *--p = (char) ('0' + (int) (m % 10));
+        m /= 10;
+    } while (m != 0);
+    if (v < 0)
+        *--p = '-';
+    return string(p, digits + sizeof(digits) - p);
+}
+
+OutputSink& operator<<(OutputSink& out, const Number& n)
+{
+    if (n.width == Number::SMALL)
+        return out << (long) n.small;
+    return out << n.ToString();
+}
@@ -0,0 +1,71 @@
+#ifndef __NUMBER__H__
+#define __NUMBER__H__
+
+#include <memory>
+#include <string>
+
+#include "bigint.h"
+#include "outsink.h"
+
+// Number is an exact integer kept in the narrowest of three forms that
+// holds it: a 64-bit int, a 128-bit int, or a BigInt. Addition and
+// multiplication of two 64-bit values are done with the overflow-checking
+// builtins and stay inline; only a result that overflows is redone in the
+// next wider form. Results are narrowed again whenever they fit, so a value
+// that overflowed once does not slow down the values computed from it.
+class Number {
+  public:
+    enum Width {
+        SMALL,      // fits in 64 bits
+        WIDE,       // fits in 128 bits
+        BIG
+    };
+
+    Number() : width(SMALL), small(0) {}
+    Number(long long v) : width(SMALL), small(v) {}
+
+    Width GetWidth() const { return width; }
+    // stores the value in v and returns true if it fits in 64 bits
+    bool GetSmall(long long& v) const
+    {
+        v = small;
+        return width == SMALL;
+    }
+
+    friend Number operator+(const Number& a, const Number& b)
+    {
+        long long r;
+        if (a.width == SMALL && b.width == SMALL && !__builtin_add_overflow(a.small, b.small, &r))
+            return Number(r);
+        return AddSlow(a, b);
+    }
+    friend Number operator*(const Number& a, const Number& b)
+    {
+        long long r;
+        if (a.width == SMALL && b.width == SMALL && !__builtin_mul_overflow(a.small, b.small, &r))
+            return Number(r);
+        return MultiplySlow(a, b);
+    }
+    // base^exponent by squaring; exponents <= 0 give 1
+    static Number Power(const Number& base, int exponent);
+
+    std::string ToString() const;
+    friend OutputSink& operator<<(OutputSink& out, const Number& n);
+
+  private:
+    static Number AddSlow(const Number& a, const Number& b);
+    static Number MultiplySlow(const Number& a, const Number& b);
+    static Number FromWide(__int128 v);
+    static Number FromBig(const BigInt& v);
+    __int128 Wide() const { return width == SMALL ? (__int128) small : wide; }
+    BigInt Big() const { return width == BIG ? *big : BigInt(Wide()); }
+
+    Width width;
+    union {
+        long long small;
+        __int128 wide;
+    };
+    std::shared_ptr<const BigInt> big;      // BIG only
+};
+
+#endif  //__NUMBER__H__
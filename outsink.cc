@@ -0,0 +1,72 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+
+#include "outsink.h"
+
+using namespace std;
+
+OutputSink::OutputSink(int fd)
+    : fd(fd), target(NULL), buffer(OUTPUT_BUFFER_SIZE), used(0), failed(false)
+{
+}
+
+OutputSink::OutputSink(string& target)
+    : fd(-1), target(&target), buffer(OUTPUT_BUFFER_SIZE), used(0), failed(false)
+{
+}
+
+OutputSink::~OutputSink()
+{
+    Flush();
+}
+
+OutputSink& OutputSink::operator<<(const char* s)
+{
+    Write(s, strlen(s));
+    return *this;
+}
+
+// Hands n bytes on to the target string or the file descriptor
+void OutputSink::Send(const char* s, size_t n)
+{
+    if (target) {
+        target->append(s, n);
+        return;
+    }
+    while (n > 0 && !failed) {
+        ssize_t written = write(fd, s, n);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) {
+            failed = true;
+            break;
+        }
+        s += written;
+        n -= written;
+    }
+}
+
+// Anything that does not fit in what is left of the buffer goes out after
+// the buffered bytes, and is only copied into the buffer if it is small
+void OutputSink::WriteLarge(const char* s, size_t n)
+{
+    Flush();
+    if (n < buffer.size()) {
+        memcpy(&buffer[0], s, n);
+        used = n;
+    } else {
+        Send(s, n);
+    }
+}
+
+void OutputSink::Flush()
+{
+    size_t n = used;
+    used = 0;
+    if (n > 0)
+        Send(&buffer[0], n);
+}
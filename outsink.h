@@ -0,0 +1,113 @@
+#ifndef __OUTSINK__H__
+#define __OUTSINK__H__
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+// bytes collected before they are handed on
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+// OutputSink collects program output in a large buffer and hands it on in
+// one piece when the buffer fills, on Flush() and on destruction, instead
+// of once per line. The output goes either to a file descriptor, standard
+// output by default, or to the end of a string the caller owns. Integers
+// are formatted two digits at a time straight into the buffer.
+class OutputSink {
+  public:
+    explicit OutputSink(int fd = 1);
+    explicit OutputSink(std::string& target);
+    ~OutputSink();
+
+    OutputSink& operator<<(int v) { return Signed(v); }
+    OutputSink& operator<<(long v) { return Signed(v); }
+    OutputSink& operator<<(unsigned v) { return Unsigned(v); }
+    OutputSink& operator<<(unsigned long v) { return Unsigned(v); }
+    OutputSink& operator<<(char c);
+    OutputSink& operator<<(const char* s);
+    OutputSink& operator<<(const std::string& s) { Write(s.data(), s.size()); return *this; }
+
+    void Write(const char* s, size_t n);
+    void Flush();
+    // true once a write to the file descriptor has failed
+    bool Failed() const { return failed; }
+
+  private:
+    OutputSink(const OutputSink&);
+    OutputSink& operator=(const OutputSink&);
+
+    OutputSink& Signed(long v);
+    OutputSink& Unsigned(unsigned long v);
+    void WriteLarge(const char* s, size_t n);
+    void Send(const char* s, size_t n);
+
+    int fd;
+    std::string* target;        // NULL when writing to fd
+    std::vector<char> buffer;
+    size_t used;
+    bool failed;
+};
+
+// Digits of v, written backward ending just before end; returns the first
+inline char* FormatDigits(unsigned long v, char* end)
+{
+    static const char pairs[201] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    while (v >= 100) {
+        unsigned r = v % 100;
+        v /= 100;
+        *--end = pairs[2 * r + 1];
+        *--end = pairs[2 * r];
+    }
+    if (v >= 10) {
+        *--end = pairs[2 * v + 1];
+        *--end = pairs[2 * v];
+    } else {
+        *--end = (char) ('0' + v);
+    }
+    return end;
+}
+
+inline void OutputSink::Write(const char* s, size_t n)
+{
+    if (buffer.size() - used >= n) {
+        memcpy(&buffer[used], s, n);
+        used += n;
+    } else {
+        WriteLarge(s, n);
+    }
+}
+
+inline OutputSink& OutputSink::operator<<(char c)
+{
+    if (used == buffer.size())
+        Flush();
+    buffer[used++] = c;
+    return *this;
+}
+
+inline OutputSink& OutputSink::Unsigned(unsigned long v)
+{
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* begin = FormatDigits(v, end);
+    Write(begin, end - begin);
+    return *this;
+}
+
+inline OutputSink& OutputSink::Signed(long v)
+{
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    // negate as unsigned so the most negative value does not overflow
+    char* begin = FormatDigits(v < 0 ? 0UL - (unsigned long) v : (unsigned long) v, end);
+    if (v < 0)
+        *--begin = '-';
+    Write(begin, end - begin);
+    return *this;
+}
+
+#endif  //__OUTSINK__H__
@@ -0,0 +1,97 @@
+#!/bin/bash
+
+# Checks --parallel against the serial run. The generated program has
+# polynomials of a few hundred terms, so that ParallelExecutor finds its
+# evaluations worth handing to other threads, and mixes independent
+# evaluations with chains through one variable, overwrites of variables
+# still to be read, and OUTPUTs in between, so that every kind of edge of
+# the dependency graph is needed. --stats must report that the program ran
+# on the threads asked for, and the output must be that of the serial run.
+# The provided tests, which are too small to run in parallel, must print
+# the same as well.
+
+if [ ! -d "./provided_tests" ]; then
+    echo "Error: tests directory not found!"
+    exit 1
+fi
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+let count=0
+let all=0
+
+mkdir -p ./output
+
+program=./output/parallel_program.txt
+{
+    echo "TASKS"
+    echo "    2"
+    echo "POLY"
+    echo -n "    P(x, y) = x^299"
+    for ((i = 0; i < 299; i++)); do echo -n " + $((i % 5 + 1)) x^$i y^$((299 - i))"; done
+    echo ";"
+    echo -n "    Q(x) = x"
+    for ((i = 2; i <= 300; i++)); do echo -n " + $((i % 3 + 1)) x^$i"; done
+    echo ";"
+    echo "EXECUTE"
+    echo "    INPUT a;"
+    echo "    INPUT b;"
+    echo "    INPUT c;"
+    for ((i = 0; i < 100; i++)); do
+        echo "    u = P(a, b);"
+        echo "    v = Q(c);"
+        echo "    OUTPUT u;"
+        echo "    w = P(v, u);"
+        echo "    a = Q(a);"
+        echo "    OUTPUT w;"
+        echo "    b = P(b, w);"
+        echo "    OUTPUT a;"
+        echo "    c = Q(u);"
+    done
+    echo "    OUTPUT b;"
+    echo "    OUTPUT c;"
+    echo "INPUTS"
+    echo "    3 5 7"
+} > ${program}
+./a.out < ${program} > ./output/parallel_serial.output
+
+for mode in "--threads 2" "--threads 4" "--threads 8" "--threads 4 --jit --jit-threshold 0" \
+            "--threads 4 --memo" "--threads 4 --dse"; do
+    all=$((all+1))
+    threads=$(sed 's/^--threads \([0-9]*\).*/\1/' <<<"${mode}")
+    ./a.out --parallel ${mode} --stats < ${program} > ./output/parallel.output 2> ./output/parallel.stats
+    if ! cmp -s ./output/parallel_serial.output ./output/parallel.output; then
+        echo "parallel [${mode}]: output differs from the serial run:"
+        echo "--------------------------------------------------------"
+        diff ./output/parallel_serial.output ./output/parallel.output
+    elif ! grep -q "ran on ${threads} threads$" ./output/parallel.stats; then
+        echo "parallel [${mode}]: expected to run on ${threads} threads, --stats reported:"
+        cat ./output/parallel.stats
+    else
+        count=$((count+1))
+        echo "parallel [${mode}]: OK"
+    fi
+    rm -f ./output/parallel.output ./output/parallel.stats
+done
+rm -f ${program} ./output/parallel_serial.output
+
+for test_file in $(find ./provided_tests -type f -name "*.txt" | sort); do
+    all=$((all+1))
+    name=`basename ${test_file} .txt`
+    folder_name="$(cut -d'/' -f3 <<<"${test_file}")"
+    if cmp -s <(./a.out < ${test_file}) <(./a.out --parallel --threads 4 < ${test_file}); then
+        count=$((count+1))
+        echo "${folder_name}/${name}: OK"
+    else
+        echo "${folder_name}/${name}: output with --parallel differs from the serial run"
+    fi
+done
+
+echo
+echo "Passed $count tests out of $all"
+echo
+
+rmdir ./output
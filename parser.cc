@@ -1,17 +1,43 @@
 #include <iostream>
 #include <cstdlib>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <climits>
+#include <fstream>
+#include <memory>
 #include "parser.h"
+#include "slotalloc.h"
+#include "vm.h"
+#include "batch.h"
+#include "driver.h"
+#include "dag.h"
+#include "bitset.h"
+#include "exact.h"
+#include "modular.h"
 
 using namespace std;
-//Task 3 funcitons
-void Parser::mark_variable_initialized(const std::string& var_name) {
-    initialized_vars.insert(var_name);
-}
-
-void Parser::check_argument_initialization(const std::string& arg_name, int line_no) {
-     if (initialized_vars.find(arg_name) == initialized_vars.end()) {
-        warning_lines.push_back(line_no);
+// Warning Code 1: a variable passed as an argument before any INPUT or
+// assignment has set it. Forward pass over the straight-line instructions
+// with one bit per variable for "definitely initialized".
+void Parser::find_uninitialized_arguments() {
+    DenseBitset initialized(next_available);
+    for (const auto& inst : instructions) {
+        switch (inst.type) {
+            case Instruction::INPUT:
+            case Instruction::CONST:
+                initialized.Set(inst.var);
+                break;
+            case Instruction::OUTPUT:
+                break;
+            case Instruction::EVAL:
+                for (size_t i = 0; i < inst.eval.args.size(); i++) {
+                    if (!initialized.Test(inst.eval.args[i]))
+                        warning_lines.push_back(inst.eval.arg_lines[i]);
+                }
+                initialized.Set(inst.eval.target);
+                break;
+        }
     }
 }
 
@@ -20,59 +46,40 @@ void Parser::report_warning_code_1() {
         return;
     }
 
-    // Sort warning lines
-    std::sort(warning_lines.begin(), warning_lines.end());
-    
-    // duplicates
+    // Sort warning lines; a line is listed once per argument
     std::sort(warning_lines.begin(), warning_lines.end());
 
-std::cout << "Warning Code 1: ";
+    out << "Warning Code 1: ";
     for (size_t i = 0; i < warning_lines.size(); i++) {
-        if (i > 0) std::cout << " ";
-        std::cout << warning_lines[i];
+        if (i > 0) out << " ";
+        out << warning_lines[i];
     }
-    std::cout << std::endl;
+    out << '\n';
 }
 
-//Task 4-> fucntions
-void Parser::mark_variable_defined(const std::string& var_name, int line_no, bool is_assignment) {
-   //std::cout << "Marking defined: " << var_name << " at line " << line_no 
-           //   << " (assignment: " << is_assignment << ")\n";
-    
-    auto it = var_usage.find(var_name);
-    if (it != var_usage.end()) {
-       // std::cout << "Previous definition found at line " << it->second.defined_line 
-                //  << " used: " << it->second.used_later << "\n";
-        if (it->second.is_assignment && !it->second.used_later) {
-           // std::cout << "Found useless assignment at line " << it->second.defined_line << "\n";
-            useless_assignments.push_back(it->second.defined_line);
-        }
-    }
-    
-    VarUsage usage(line_no, is_assignment);
-    var_usage[var_name] = usage;
-}
-
-void Parser::mark_variable_used(const std::string& var_name) {
- //  std::cout << "Marking used: " << var_name << "\n";
-    auto it = var_usage.find(var_name);
-    if (it != var_usage.end()) {
-        it->second.used_later = true;
-     //   std::cout << "Variable " << var_name << " marked as used from line " 
-                 // << it->second.defined_line << "\n";
-    }
-}
-
-void Parser::check_useless_assignments() {
-// Check any remaining unused assignments
-   // std::cout << "\nChecking final useless assignments:\n";
-    for (const auto& pair : var_usage) {
-       // std::cout << "Variable: " << pair.first 
-                 // << " Line: " << pair.second.defined_line 
-                //  << " Assignment: " << pair.second.is_assignment 
-                 // << " Used: " << pair.second.used_later << "\n";
-        if (pair.second.is_assignment && !pair.second.used_later) {
-            useless_assignments.push_back(pair.second.defined_line);
+// Warning Code 2: an assignment whose value is never read, because the
+// variable is set again or the program ends first. Backward liveness pass
+// with one bit per variable; an assignment is useless if its target is not
+// live after it. Temporaries are always read, so only statements count.
+void Parser::find_useless_assignments() {
+    DenseBitset live(next_available);
+    for (size_t i = instructions.size(); i-- > 0; ) {
+        const Instruction& inst = instructions[i];
+        switch (inst.type) {
+            case Instruction::INPUT:
+            case Instruction::CONST:
+                live.Reset(inst.var);
+                break;
+            case Instruction::OUTPUT:
+                live.Set(inst.var);
+                break;
+            case Instruction::EVAL:
+                if (inst.line > 0 && !live.Test(inst.eval.target))
+                    useless_assignments.push_back(inst.line);
+                live.Reset(inst.eval.target);
+                for (int arg : inst.eval.args)
+                    live.Set(arg);
+                break;
         }
     }
 }
@@ -87,12 +94,12 @@ void Parser::report_warning_code_2() {
     auto last = std::unique(useless_assignments.begin(), useless_assignments.end());
     useless_assignments.erase(last, useless_assignments.end());
 
-    std::cout << "Warning Code 2: ";
+    out << "Warning Code 2: ";
     for (size_t i = 0; i < useless_assignments.size(); i++) {
-        if (i > 0) std::cout << " ";
-        std::cout << useless_assignments[i];
+        if (i > 0) out << " ";
+        out << useless_assignments[i];
     }
-    std::cout << std::endl;
+    out << '\n';
 }
 
 
@@ -103,49 +110,52 @@ void Parser::processTaskNumber(int num) {
     }
 }
 
-void Parser::executeAllTasks() {
+int Parser::executeAllTasks() {
     // execute task 1 (syntax and semantic checking)
     bool task1_listed = tasks[1];
     bool hasError = false;
 
     // Check for syntax and semantic errors - Task 1
     try {
-        parse_poly_section();
-        parse_execute_section();
+        // a program from the cache is already compiled up to INPUTS
+        if (!cached) {
+            parse_poly_section();
+            parse_execute_section();
+        }
         parse_inputs_section();
         expect(END_OF_FILE);
 
-        // Check semantic errors
+        // Check semantic errors; only the first code found is reported
         if (!semantic_error.lines.empty()) {
-            if (task1_listed) semantic_error.reportError(1);
+            if (task1_listed) semantic_error.reportError(1, out);
             hasError = true;
-        }
-        if (!semantic_error2.lines.empty()) {
-            if (task1_listed) semantic_error2.reportError(2);
+        } else if (!semantic_error2.lines.empty()) {
+            if (task1_listed) semantic_error2.reportError(2, out);
             hasError = true;
-        }
-        if (!semantic_error3.lines.empty()) {
-            if (task1_listed) semantic_error3.reportError(3);
+        } else if (!semantic_error3.lines.empty()) {
+            if (task1_listed) semantic_error3.reportError(3, out);
             hasError = true;
-        }
-        if (!semantic_error4.lines.empty()) {
-            if (task1_listed) semantic_error4.reportError(4);
+        } else if (!semantic_error4.lines.empty()) {
+            if (task1_listed) semantic_error4.reportError(4, out);
             hasError = true;
         }
     } catch (const SyntaxError&) {
         if (task1_listed) {
-            cout << "SYNTAX ERROR !!!!!&%!!\n";
+            out << "SYNTAX ERROR !!!!!&%!!\n";
         }
         hasError = true;
+        cacheable = false;
     }
 
-    // If there were errors and task 1 was listed, exit
+    // If there were errors and task 1 was listed, stop here
     if (hasError && task1_listed) {
-        exit(1);
+        return 1;
     }
 
     // If no errors, or if errors but task 1 not listed, continue with other tasks
     if (!hasError || !task1_listed) {
+        compile_program();
+
         // Execute other tasks in order
         if (tasks[2]) {
             execute_program();
@@ -154,244 +164,680 @@ void Parser::executeAllTasks() {
             report_warning_code_1();
         }
         if (tasks[4]) {
-            check_useless_assignments();
             report_warning_code_2();
         }
     }
+    return 0;
 }
 
 
-Parser::Parser() : next_available(0), current_input_index(0), current_term_list(nullptr), current_coefficient(1) {}
+Parser::Parser(OutputSink& out, const ExecutionOptions& options, int fd, Arena* arena)
+    : options(options), out(out), cached(false), cacheable(false), source_offset(0), lexer(fd),
+      arena(arena ? *arena : own_arena), nesting_depth(0),
+      next_available(0), dead_stores(0) {}
 
-int Parser::evaluate_primary(const Primary* primary, const std::vector<std::string>& params, const std::vector<int>& args) {
-    if (!primary) return 0;
-    if (primary->kind == VAR) {
-        if (primary->var >= 0 && primary->var < static_cast<int>(args.size())) {
-            return args[primary->var];
-        }
-        return 0;
-    } else {
-        return evaluate_term_list(primary->t_list, params, args);
-    }
+// Everything that does not depend on the INPUTS section: the warnings, then
+// the bytecode. A program loaded from the cache already has all of it, and
+// one that was not is stored once it is compiled.
+void Parser::compile_program() {
+    if (cached)
+        return;
+    // the warnings look at variable ids, which assign_memory_slots() replaces with slots
+    if (tasks[3])
+        find_uninitialized_arguments();
+    if (tasks[4])
+        find_useless_assignments();
+
+    dead_stores = options.dse ? eliminate_dead_stores() : 0;
+    assign_memory_slots();
+    compile_bytecode();
+    if (cache && cacheable)
+        store_cached_program();
 }
 
-int Parser::evaluate_monomial(const Monomial& monomial, const std::vector<std::string>& params, const std::vector<int>& args) {
-   if (!monomial.primary) return 1;
-    
-    // Get the base value
-    int base = evaluate_primary(monomial.primary, params, args);
-    
-    // Apply exponent
-    int result = 1;
-    for (int i = 0; i < monomial.exponent; i++) {
-        result *= base;
+// Dead-store elimination. Liveness is propagated backward from the OUTPUT
+// statements, and an EVAL or CONST whose target is not live after it is
+// dropped, along with everything that only fed it. INPUTs are always kept
+// since each one consumes a value of the input. Returns the number of
+// evaluations dropped.
+int Parser::eliminate_dead_stores() {
+    DenseBitset live(next_available);
+    std::vector<bool> keep(instructions.size(), true);
+    int skipped = 0;
+    for (size_t i = instructions.size(); i-- > 0; ) {
+        const Instruction& inst = instructions[i];
+        switch (inst.type) {
+            case Instruction::INPUT:
+                live.Reset(inst.var);
+                break;
+            case Instruction::OUTPUT:
+                live.Set(inst.var);
+                break;
+            case Instruction::CONST:
+                if (!live.Test(inst.var))
+                    keep[i] = false;
+                live.Reset(inst.var);
+                break;
+            case Instruction::EVAL:
+                if (!live.Test(inst.eval.target)) {
+                    keep[i] = false;
+                    skipped++;
+                    break;
+                }
+                live.Reset(inst.eval.target);
+                for (int arg : inst.eval.args)
+                    live.Set(arg);
+                break;
+        }
     }
-    return result;
-}
-
 
-int Parser::evaluate_monomial_list(const struct monomial_list* list, const std::vector<std::string>& params, const std::vector<int>& args) {
-    if (!list) return 1;
-    
-    // Multiply current monomial value with rest of the list
-    int current = evaluate_monomial(list->monomial, params, args);
-    int rest = evaluate_monomial_list(list->next, params, args);
-    return current * rest;
+    size_t kept = 0;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (keep[i]) {
+            if (kept != i)
+                instructions[kept] = std::move(instructions[i]);
+            kept++;
+        }
     }
+    instructions.resize(kept);
+    return skipped;
+}
 
-int Parser::evaluate_term(const Term& term, const std::vector<std::string>& params, const std::vector<int>& args) {
-    if (term.is_constant) {
-        return term.coefficient;
-    }
-    
-    int result = term.coefficient;  // Start with coefficient
-    
-    if (!term.var.empty()) {
-        // Handle variable terms
-        auto it = std::find(params.begin(), params.end(), term.var);
-        if (it != params.end()) {
-            int index = std::distance(params.begin(), it);
-            if (index < args.size()) {
-                int base = args[index];
-                int powered = 1;
-                // Apply exponent
-                for (int i = 0; i < term.exponent; i++) {
-                    powered *= base;
-                }
-                result *= powered;
-            }
+// Replaces the variable ids in the instructions with memory slots. Variables
+// whose live ranges do not overlap share a slot, so mem only has to hold as
+// many values as are live at once.
+void Parser::assign_memory_slots() {
+    SlotAllocator allocator(next_available);
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const Instruction& inst = instructions[i];
+        switch (inst.type) {
+            case Instruction::INPUT:
+                allocator.Write(inst.var, i);
+                break;
+            case Instruction::OUTPUT:
+                allocator.Read(inst.var, i);
+                break;
+            case Instruction::CONST:
+                allocator.Write(inst.var, i);
+                break;
+            case Instruction::EVAL:
+                for (int arg : inst.eval.args)
+                    allocator.Read(arg, i);
+                allocator.Write(inst.eval.target, i);
+                break;
         }
-    } else if (term.monomial_list) {
-        // Handle complex terms
-        result *= evaluate_monomial_list(term.monomial_list, params, args);
     }
-    
-    return result;
-}
-int Parser::evaluate_term_list(const struct term_list* list, const std::vector<std::string>& params, const std::vector<int>& args) {
-    if (!list) return 0;
-    
-    int term_val = evaluate_term(list->term, params, args);
-    
-    if (!list->next) return term_val;
-    
-    int next_val = evaluate_term_list(list->next, params, args);
-    return list->op == OP_PLUS ? term_val + next_val : term_val - next_val;
-}
-                
-//polynomial evaluation
-int Parser::evaluate_polynomial(const std::string& poly_name, const std::vector<int>& args) {
-
-     for (auto& p : parsed_polynomials) {
-        if (p.name == poly_name) {
-            int result = 0;
-            for (const auto& term : p.terms) {
-                result += evaluate_term(term, p.params, args);
-            }
-            return result;
+
+    std::vector<int> slot;
+    int slot_count = allocator.Allocate(slot);
+    for (auto& inst : instructions) {
+        if (inst.type == Instruction::EVAL) {
+            inst.eval.target = slot[inst.eval.target];
+            for (int& arg : inst.eval.args)
+                arg = slot[arg];
+        } else {
+            inst.var = slot[inst.var];
         }
     }
-    return 0;
+    for (auto& var : symbol_table)
+        var.location = slot[var.location];
 
+    mem.assign(slot_count, 0);
 }
 
-void Parser::execute_program() {
-  mem.resize(1000, 0);
-    current_input_index = 0;
-    
+// Lowers the instructions, now that they refer to memory slots, to the
+// bytecode the VM runs. A call to an undeclared polynomial evaluates to 0.
+void Parser::compile_bytecode() {
     for (const auto& inst : instructions) {
         switch (inst.type) {
-            case Instruction::INPUT: {
-                for (const auto& var : symbol_table) {
-                    if (var.name == inst.var_name) {
-                        mem[var.location] = input_values[current_input_index++];
-                        break;
-                    }
-                }
+            case Instruction::INPUT:
+                bytecode.Input(inst.var);
                 break;
-            }
-            case Instruction::OUTPUT: {
-                for (const auto& var : symbol_table) {
-                    if (var.name == inst.var_name) {
-                        std::cout << mem[var.location] << std::endl;
-                        break;
-                    }
-                }
+            case Instruction::OUTPUT:
+                bytecode.Output(inst.var);
                 break;
-            }
-            case Instruction::EVAL: {
-                std::vector<int> arg_values;
-                for (const auto& arg_name : inst.eval.arg_vars) {
-                    for (const auto& var : symbol_table) {
-                        if (var.name == arg_name) {
-                            arg_values.push_back(mem[var.location]);
-                            break;
-                        }
-                    }
-                }
-                
-                for (const auto& var : symbol_table) {
-                    if (var.name == inst.eval.target_var) {
-                        mem[var.location] = evaluate_polynomial(inst.eval.poly_name, arg_values);
-                        break;
-                    }
-                }
+            case Instruction::CONST:
+                bytecode.Const(inst.var, inst.value);
                 break;
+            case Instruction::EVAL:
+                if (inst.eval.poly_id < 0)
+                    bytecode.Const(inst.eval.target, 0);
+                else
+                    bytecode.Eval(inst.eval.poly_id, inst.eval.target, inst.eval.args);
+                break;
+        }
+    }
+    bytecode.Halt();
+}
+
+void Parser::execute_program() {
+    if (options.modulus) {
+        execute_modular();
+        return;
+    }
+    if (options.exact) {
+        execute_exact();
+        return;
+    }
+    std::vector<const CompiledPolynomial*> polys;
+    for (const auto& p : parsed_polynomials)
+        polys.push_back(&p.code);
+    if (options.batch) {
+        execute_batch(polys);
+        return;
+    }
+    JitCompiler jit;
+    VirtualMachine vm(polys, options.jit ? &jit : NULL, options.jit_threshold, options.memo);
+
+    std::unique_ptr<ParallelExecutor> parallel;
+    if (options.parallel)
+        parallel.reset(new ParallelExecutor(bytecode, polys, mem.size(), options.threads));
+    bool run_parallel = parallel && parallel->Worthwhile();
+
+    auto start = std::chrono::steady_clock::now();
+    if (run_parallel)
+        parallel->Run(vm, mem.data(), input_values, out);
+    else
+        vm.Run(bytecode, mem.data(), input_values, out);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (options.stats) {
+        out.Flush();
+        double seconds = elapsed.count();
+        std::cerr << "executed " << bytecode.InstructionCount() << " instructions in "
+                  << seconds << " s (" << (seconds > 0 ? bytecode.InstructionCount() / seconds : 0)
+                  << " instructions/s)" << std::endl;
+        if (options.dse)
+            std::cerr << "dead-store elimination skipped " << dead_stores << " evaluations" << std::endl;
+        if (parallel)
+            std::cerr << "dependency graph: " << parallel->NodeCount() << " nodes, "
+                      << parallel->EdgeCount() << " edges, " << parallel->ExpensiveCount()
+                      << " expensive evaluations, "
+                      << (run_parallel ? "ran on " : "ran serially, would have used ")
+                      << parallel->ThreadCount() << " threads" << std::endl;
+        if (options.jit)
+            std::cerr << "compiled " << jit.FunctionCount() << " of " << polys.size()
+                      << " polynomials to native code" << std::endl;
+        for (size_t i = 0; options.memo && i < polys.size(); i++) {
+            const MemoCache* memo = vm.Memo(i);
+            std::cerr << "memo " << lexer.Name(parsed_polynomials[i].name) << ": "
+                      << memo->Hits() << " hits, " << memo->Misses() << " misses"
+                      << (memo->Enabled() ? "" : ", disabled") << std::endl;
+        }
+    }
+}
+
+// Batch mode runs the program once per record, where a record is as many
+// values as the program has INPUT statements. The records are either the
+// INPUTS section cut into pieces of that size or the lines of
+// options.batch_file. A short record reads 0 for its missing inputs, as a
+// single run would.
+void Parser::execute_batch(const std::vector<const CompiledPolynomial*>& polys)
+{
+    int record_size = bytecode.InputCount();
+    long record_count = 0;
+    std::vector<int> records;
+
+    if (options.batch_file.empty()) {
+        records = input_values;
+        record_count = record_size > 0 ? (records.size() + record_size - 1) / record_size : 1;
+    } else {
+        std::ifstream file(options.batch_file.c_str());
+        std::string line;
+        while (std::getline(file, line)) {
+            const char* p = line.c_str();
+            char* end;
+            int n = 0;
+            for (long v = strtol(p, &end, 10); end != p; v = strtol(p, &end, 10)) {
+                if (n++ < record_size)
+                    records.push_back((int) v);
+                p = end;
             }
+            if (n == 0)
+                continue;       // blank line
+            for (; n < record_size; n++)
+                records.push_back(0);
+            record_count++;
         }
     }
+    records.resize((size_t) record_count * record_size, 0);
+
+    BatchMachine machine(polys);
+    auto start = std::chrono::steady_clock::now();
+    machine.Run(bytecode, mem.size(), records, record_size, record_count, out);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (options.stats) {
+        double seconds = elapsed.count();
+        std::cerr << "ran " << record_count << " records in " << seconds << " s ("
+                  << (seconds > 0 ? record_count / seconds : 0) << " records/s, "
+                  << machine.Kernel() << " kernel)" << std::endl;
+    }
 }
 
+// Exact and modular mode evaluate from the AST of each polynomial rather
+// than from its compiled form, whose coefficients have already been reduced
+// mod 2^32. A cached program has no ASTs but stores the exact forms.
+void Parser::compile_exact(std::vector<ExactPolynomial>& exact, std::vector<const ExactPolynomial*>& polys)
+{
+    if (cached)
+        exact = cached_exact;
+    else
+        exact.resize(parsed_polynomials.size());
+    for (size_t i = 0; i < parsed_polynomials.size(); i++) {
+        if (!cached)
+            CompileExact(parsed_polynomials[i].body, parsed_polynomials[i].param_count, exact[i]);
+        polys.push_back(&exact[i]);
+    }
+}
 
-void Parser::syntax_error()
+void Parser::execute_exact()
 {
-    throw SyntaxError();
+    std::vector<ExactPolynomial> exact;
+    std::vector<const ExactPolynomial*> polys;
+    compile_exact(exact, polys);
+
+    ExactMachine machine(polys);
+    auto start = std::chrono::steady_clock::now();
+    machine.Run(bytecode, mem.size(), input_values, out);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (options.stats) {
+        out.Flush();
+        double seconds = elapsed.count();
+        std::cerr << "executed " << bytecode.InstructionCount() << " instructions exactly in "
+                  << seconds << " s (" << (seconds > 0 ? bytecode.InstructionCount() / seconds : 0)
+                  << " instructions/s)" << std::endl;
+        std::cerr << "exact: " << machine.EvaluationCount() << " evaluations, " << machine.WideCount()
+                  << " needed 128 bits, " << machine.BigCount() << " needed more" << std::endl;
+    }
 }
 
-Token Parser::expect(TokenType expected_type)
+void Parser::execute_modular()
 {
-    Token t = lexer.GetToken();
-    if (t.token_type != expected_type)
-        syntax_error();
-    return t;
+    std::vector<ExactPolynomial> exact;
+    std::vector<const ExactPolynomial*> polys;
+    compile_exact(exact, polys);
+
+    ModularMachine machine(polys, options.modulus);
+    auto start = std::chrono::steady_clock::now();
+    machine.Run(bytecode, mem.size(), input_values, out);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (options.stats) {
+        out.Flush();
+        double seconds = elapsed.count();
+        std::cerr << "executed " << bytecode.InstructionCount() << " instructions mod " << options.modulus
+                  << " in " << seconds << " s (" << (seconds > 0 ? bytecode.InstructionCount() / seconds : 0)
+                  << " instructions/s)" << std::endl;
+    }
 }
-// Implementation of allocate_variable
-int Parser::allocate_variable(const std::string& var_name) {
-    // Check if variable already exists
-    for (const auto& var : symbol_table) {
-        if (var.name == var_name) {
-            return var.location;
-        }
+
+// Hashes the program text before INPUTS and loads the compiled program
+// stored under it, if there is one
+void Parser::open_cache()
+{
+    size_t len;
+    const char* source = lexer.Source(len);
+    source_offset = lexer.Offset();
+    cache.reset(new ProgramCache(options.cache_dir, source, len, options.dse ? 1 : 0));
+    if (cache->Open() && load_cached_program()) {
+        cached = true;
+        lexer.Skip(cache->PrefixLength());
     }
-    
-    // Variable doesn't exist, allocate new location
-    VariableInfo new_var;
-    new_var.name = var_name;
-    new_var.location = next_available++;
-    symbol_table.push_back(new_var);
-    
-    return new_var.location;
+    if (options.stats)
+        std::cerr << "program cache " << (cached ? "hit" : "miss") << std::endl;
 }
 
-// Implementation of print_symbol_table
-void Parser::print_symbol_table()const
- {
-    std::cout << "\nSymbol Table Contents:" << std::endl;
-    std::cout << "Variable\tLocation" << std::endl;
-    std::cout << "--------\t--------" << std::endl;
-    for (const auto& var : symbol_table) {
-        std::cout << var.name << "\t\t" << var.location << std::endl;
+// a run of n offsets going from 0 up to last without stepping back
+static bool ValidOffsets(const int* begin, int n, int last)
+{
+    if (begin[0] != 0 || begin[n - 1] != last)
+        return false;
+    for (int i = 1; i < n; i++) {
+        if (begin[i] < begin[i - 1])
+            return false;
     }
+    return true;
 }
-//storing input from num_list parsing 
-void Parser::store_input_value(const std::string& num_lexeme) {
-    input_values.push_back(std::atoi(num_lexeme.c_str()));
+
+static bool InRange(const int* values, int n, int low, int high)
+{
+    for (int i = 0; i < n; i++) {
+        if (values[i] < low || values[i] >= high)
+            return false;
+    }
+    return true;
 }
-// Get next input value (for use during execution)
-int Parser::get_next_input() {
-    if (current_input_index < input_values.size()) {
-        return input_values[current_input_index++];
+
+// The sums of a polynomial may only use its parameters and earlier sums
+static bool ValidFactorSlots(const int* sum_begin, const int* term_begin, const int* factor_slot,
+                             int param_count, int sum_count)
+{
+    for (int s = 0; s < sum_count; s++) {
+        int first = term_begin[sum_begin[s]], last = term_begin[sum_begin[s + 1]];
+        if (!InRange(factor_slot + first, last - first, 0, param_count + s))
+            return false;
     }
-    // Handle error case - not enough inputs
-    std::cout << "Error: Not enough input values\n";
-    exit(1);
+    return true;
 }
 
-// Debug function to print input values
-void Parser::print_input_values() {
-    std::cout << "\nStored Input Values:" << std::endl;
-    for (size_t i = 0; i < input_values.size(); i++) {
-        std::cout << i << ": " << input_values[i] << std::endl;
+// Checks every count and index of a compiled polynomial read from the
+// cache, so that evaluating it stays inside its arrays and its table
+static bool ValidCompiled(const CompiledPolynomial& p)
+{
+    if (p.param_count < 0 || p.sum_count < 1 || p.slot_count != p.param_count + p.sum_count - 1 ||
+        p.constant_count < 2 || p.scratch_size < p.param_count + p.power_count + p.constant_count)
+        return false;
+    if (!ValidOffsets(p.sum_begin, p.sum_count + 1, p.term_count) ||
+        !ValidOffsets(p.term_begin, p.term_count + 1, p.factor_count) ||
+        !ValidFactorSlots(p.sum_begin, p.term_begin, p.factor_slot, p.param_count, p.sum_count) ||
+        !InRange(p.factor_exponent, p.factor_count, 1, INT_MAX))
+        return false;
+    if (p.constants[0] != 0 || p.constants[1] != 1 ||
+        !ValidOffsets(p.power_begin, p.sum_count + 1, p.power_count) ||
+        !InRange(p.power_base, p.power_count, 0, p.scratch_size) ||
+        !InRange(p.power_step, p.power_count, 1, INT_MAX) ||
+        !InRange(p.power_previous, p.power_count, 0, p.scratch_size) ||
+        !ValidOffsets(p.step_begin, p.sum_count + 1, p.step_begin[p.sum_count]) ||
+        !InRange(p.steps, 4 * p.step_begin[p.sum_count], 0, p.scratch_size) ||
+        !InRange(p.sum_result, p.sum_count, 0, p.scratch_size))
+        return false;
+    // steps only write temporaries
+    int temp_base = p.param_count + p.power_count + p.constant_count;
+    for (int i = 0; i < p.step_begin[p.sum_count]; i++) {
+        if (p.steps[4 * i] < temp_base)
+            return false;
     }
+    return true;
 }
 
+static bool ValidExact(const ExactPolynomial& p)
+{
+    int term_count = p.coefficients.size();
+    int factor_count = p.factor_slot.size();
+    return p.sum_count >= 1 && (int) p.sum_begin.size() == p.sum_count + 1 &&
+           (int) p.term_begin.size() == term_count + 1 && (int) p.factor_exponent.size() == factor_count &&
+           ValidOffsets(p.sum_begin.data(), p.sum_count + 1, term_count) &&
+           ValidOffsets(p.term_begin.data(), term_count + 1, factor_count) &&
+           ValidFactorSlots(p.sum_begin.data(), p.term_begin.data(), p.factor_slot.data(), p.param_count,
+                            p.sum_count) &&
+           InRange(p.factor_exponent.data(), factor_count, 1, INT_MAX);
+}
 
-// Parsing
-void Parser::ConsumeAllInput()
+// Walks the bytecode the way the machines do and checks that every slot is
+// in mem, every polynomial exists, the code ends in exactly one OP_HALT and
+// the counts are the ones stored with it
+static bool ValidBytecode(const Bytecode& bytecode, int slot_count, int poly_count)
+{
+    const int* pc = bytecode.Code();
+    const int* end = pc + bytecode.Size();
+    long instructions = 0, inputs = 0;
+    while (pc < end) {
+        int size;
+        switch (*pc) {
+            case OP_INPUT:  size = 2; inputs++; break;
+            case OP_OUTPUT: size = 2; break;
+            case OP_CONST:  size = 3; break;
+            case OP_EVAL:
+                if (end - pc < 4 || pc[3] < 0)
+                    return false;
+                size = 4 + pc[3];
+                break;
+            case OP_HALT:
+                return pc + 1 == end && instructions == bytecode.InstructionCount() &&
+                       inputs == bytecode.InputCount();
+            default:
+                return false;
+        }
+        if (end - pc < size)
+            return false;
+        if (*pc == OP_EVAL) {
+            if (pc[1] < 0 || pc[1] >= poly_count || !InRange(pc + 2, 1, 0, slot_count) ||
+                !InRange(pc + 4, pc[3], 0, slot_count))
+                return false;
+        } else if (!InRange(pc + 1, 1, 0, slot_count)) {
+            return false;
+        }
+        instructions++;
+        pc += size;
+    }
+    return false;
+}
+
+// The entry is read in the order store_cached_program() wrote it. Arrays
+// of the compiled polynomials point into the mapping rather than being
+// copied. Everything is checked before it is used, and an entry that
+// fails a check counts as a miss.
+bool Parser::load_cached_program()
+{
+    ProgramCache& c = *cache;
+    for (int i = 0; i < 7; i++)
+        tasks[i] = c.ReadInt() != 0;
+    c.ReadVector(semantic_error.lines);
+    c.ReadVector(semantic_error2.lines);
+    c.ReadVector(semantic_error3.lines);
+    c.ReadVector(semantic_error4.lines);
+    c.ReadVector(warning_lines);
+    c.ReadVector(useless_assignments);
+    int slot_count = c.ReadInt();
+    dead_stores = c.ReadInt();
+
+    size_t code_size = (unsigned) c.ReadInt();
+    long instruction_count = c.ReadLong();
+    long input_count = c.ReadLong();
+    const int* code = c.ReadInts(code_size);
+    if (code)
+        bytecode.Assign(code, code_size, instruction_count, input_count);
+    // every slot is named by an instruction, and mem has at least one
+    bool valid = slot_count >= 0 && (size_t) slot_count <= code_size + 1;
+
+    int poly_count = c.ReadInt();
+    for (int i = 0; i < poly_count && valid && !c.Failed(); i++) {
+        ParsedPolynomial poly;
+        std::vector<int> name;
+        c.ReadVector(name);
+        poly.name = lexer.Intern(std::string(name.begin(), name.end()));
+        poly.body = NULL;
+
+        CompiledPolynomial& p = poly.code;
+        p.param_count = poly.param_count = c.ReadInt();
+        p.slot_count = c.ReadInt();
+        p.sum_count = c.ReadInt();
+        p.term_count = c.ReadInt();
+        p.factor_count = c.ReadInt();
+        p.scratch_size = c.ReadInt();
+        p.power_count = c.ReadInt();
+        p.constant_count = c.ReadInt();
+        // each count sizes an array still to be read, so none can be larger
+        // than what is left
+        size_t left = c.Remaining();
+        if (c.Failed() || p.sum_count < 1 || p.term_count < 0 || p.factor_count < 0 || p.power_count < 0 ||
+            p.constant_count < 0 || (size_t) p.sum_count >= left || (size_t) p.term_count >= left ||
+            (size_t) p.factor_count > left || (size_t) p.power_count > left || (size_t) p.constant_count > left) {
+            valid = false;
+            break;
+        }
+        p.sum_begin = c.ReadInts(p.sum_count + 1);
+        p.coefficients = c.ReadInts(p.term_count);
+        p.term_begin = c.ReadInts(p.term_count + 1);
+        p.factor_slot = c.ReadInts(p.factor_count);
+        p.factor_exponent = c.ReadInts(p.factor_count);
+        p.constants = c.ReadInts(p.constant_count);
+        p.power_begin = c.ReadInts(p.sum_count + 1);
+        p.power_base = c.ReadInts(p.power_count);
+        p.power_step = c.ReadInts(p.power_count);
+        p.power_previous = c.ReadInts(p.power_count);
+        p.step_begin = c.ReadInts(p.sum_count + 1);
+        p.steps = p.step_begin ? c.ReadInts(4 * (size_t) (unsigned) p.step_begin[p.sum_count]) : NULL;
+        p.sum_result = c.ReadInts(p.sum_count);
+        if (c.Failed() || !ValidCompiled(p)) {
+            valid = false;
+            break;
+        }
+        parsed_polynomials.push_back(poly);
+
+        ExactPolynomial exact;
+        exact.param_count = c.ReadInt();
+        exact.sum_count = c.ReadInt();
+        c.ReadVector(exact.sum_begin);
+        size_t term_count = (unsigned) c.ReadInt();
+        if (term_count > c.Remaining() / 2) {
+            valid = false;
+            break;
+        }
+        exact.coefficients.resize(term_count);
+        for (auto& coefficient : exact.coefficients)
+            coefficient = c.ReadLong();
+        c.ReadVector(exact.term_begin);
+        c.ReadVector(exact.factor_slot);
+        c.ReadVector(exact.factor_exponent);
+        if (c.Failed() || exact.param_count != p.param_count || !ValidExact(exact)) {
+            valid = false;
+            break;
+        }
+        cached_exact.push_back(exact);
+    }
+
+    if (valid && !c.Failed() && (int) parsed_polynomials.size() == poly_count &&
+        ValidBytecode(bytecode, slot_count, poly_count)) {
+        mem.assign(slot_count, 0);
+        return true;
+    }
+    // a damaged entry; compile the program from its source instead
+    std::fill(tasks, tasks + 7, false);
+    semantic_error.lines.clear();
+    semantic_error2.lines.clear();
+    semantic_error3.lines.clear();
+    semantic_error4.lines.clear();
+    warning_lines.clear();
+    useless_assignments.clear();
+    mem.clear();
+    dead_stores = 0;
+    bytecode = Bytecode();
+    parsed_polynomials.clear();
+    cached_exact.clear();
+    return false;
+}
+
+void Parser::store_cached_program()
 {
-    parse_tasks_section();
-    // parse_poly_section();
-    // parse_execute_section();
-    // parse_inputs_section();
+    ProgramCache& c = *cache;
+    for (int i = 0; i < 7; i++)
+        c.WriteInt(tasks[i]);
+    c.WriteVector(semantic_error.lines);
+    c.WriteVector(semantic_error2.lines);
+    c.WriteVector(semantic_error3.lines);
+    c.WriteVector(semantic_error4.lines);
+    c.WriteVector(warning_lines);
+    c.WriteVector(useless_assignments);
+    c.WriteInt(mem.size());
+    c.WriteInt(dead_stores);
+
+    c.WriteInt(bytecode.Size());
+    c.WriteLong(bytecode.InstructionCount());
+    c.WriteLong(bytecode.InputCount());
+    c.WriteInts(bytecode.Code(), bytecode.Size());
+
+    c.WriteInt(parsed_polynomials.size());
+    for (const auto& poly : parsed_polynomials) {
+        const std::string& name = lexer.Name(poly.name);
+        c.WriteVector(std::vector<int>(name.begin(), name.end()));
+
+        const CompiledPolynomial& p = poly.code;
+        c.WriteInt(p.param_count);
+        c.WriteInt(p.slot_count);
+        c.WriteInt(p.sum_count);
+        c.WriteInt(p.term_count);
+        c.WriteInt(p.factor_count);
+        c.WriteInt(p.scratch_size);
+        c.WriteInt(p.power_count);
+        c.WriteInt(p.constant_count);
+        c.WriteInts(p.sum_begin, p.sum_count + 1);
+        c.WriteInts(p.coefficients, p.term_count);
+        c.WriteInts(p.term_begin, p.term_count + 1);
+        c.WriteInts(p.factor_slot, p.factor_count);
+        c.WriteInts(p.factor_exponent, p.factor_count);
+        c.WriteInts(p.constants, p.constant_count);
+        c.WriteInts(p.power_begin, p.sum_count + 1);
+        c.WriteInts(p.power_base, p.power_count);
+        c.WriteInts(p.power_step, p.power_count);
+        c.WriteInts(p.power_previous, p.power_count);
+        c.WriteInts(p.step_begin, p.sum_count + 1);
+        c.WriteInts(p.steps, 4 * p.step_begin[p.sum_count]);
+        c.WriteInts(p.sum_result, p.sum_count);
+
+        ExactPolynomial exact;
+        CompileExact(poly.body, poly.param_count, exact);
+        c.WriteInt(exact.param_count);
+        c.WriteInt(exact.sum_count);
+        c.WriteVector(exact.sum_begin);
+        c.WriteInt(exact.coefficients.size());
+        for (long long coefficient : exact.coefficients)
+            c.WriteLong(coefficient);
+        c.WriteVector(exact.term_begin);
+        c.WriteVector(exact.factor_slot);
+        c.WriteVector(exact.factor_exponent);
+    }
 
-    // expect(END_OF_FILE);
+    bool stored = c.Commit();
+    if (options.stats)
+        std::cerr << (stored ? "stored compiled program in the cache" : "cannot write to the program cache")
+                  << std::endl;
+}
 
-    // //reporting error at the end
+void Parser::syntax_error()
+{
+    throw SyntaxError();
+}
+
+// Parenthesized primaries and nested polynomial evaluations are the only
+// productions that still recurse, so their depth is capped to keep deep
+// nesting from overflowing the stack.
+void Parser::enter_nesting()
+{
+    if (++nesting_depth > MAX_NESTING_DEPTH)
+        syntax_error();
+}
+
+Token Parser::expect(TokenType expected_type)
+{
+    Token t = lexer.GetToken();
+    if (t.token_type != expected_type)
+        syntax_error();
+    return t;
+}
+// Returns the id of a variable, given its interned name, and allocates one
+// the first time the variable is referenced. Variable ids are dense and are
+// mapped onto memory slots by assign_memory_slots() once parsing is done.
+int Parser::allocate_variable(int name) {
+    if (name >= (int) var_slot.size())
+        var_slot.resize(name + 1, -1);
+    if (var_slot[name] >= 0)
+        return var_slot[name];
+
+    // Variable doesn't exist, allocate new location
+    VariableInfo new_var;
+    new_var.name = name;
+    new_var.location = next_available++;
+    symbol_table.push_back(new_var);
+    var_slot[name] = new_var.location;
 
-    // if (!semantic_error.lines.empty()) {
-    //     semantic_error.reportError(1);
-    // }
-    // if (!semantic_error2.lines.empty()) {
-    //     semantic_error2.reportError(2);
-    // }
-    // if (!semantic_error3.lines.empty()) {
-    //     semantic_error3.reportError(3); 
-    // }
-    // if (!semantic_error4.lines.empty()) {
-    //     semantic_error4.reportError(4); 
-    // }
-    executeAllTasks();
+    return new_var.location;
+}
 
+// Parsing
+int Parser::ConsumeAllInput()
+{
+    if (!options.cache_dir.empty())
+        open_cache();
+    try {
+        if (!cached)
+            parse_tasks_section();
+    } catch (const SyntaxError&) {
+        return 1;
+    }
+    return executeAllTasks();
 }
 
 void Parser::parse_tasks_section()
@@ -402,19 +848,11 @@ void Parser::parse_tasks_section()
 
 void Parser::parse_num_list()
 {
-    Token t = expect(NUM);
-    // Only store if we're in INPUTS section
-    if (in_inputs_section) {  // Add this as a boolean member variable
-        store_input_value(t.lexeme);
-    }else {
+    do {
+        Token t = expect(NUM);
         // Process task number
-        processTaskNumber(std::atoi(t.lexeme.c_str()));
-    }
-
-    Token next = lexer.peek(1);
-    if (next.token_type == NUM) {
-        parse_num_list();
-    }
+        processTaskNumber(t.value);
+    } while (lexer.peek(1).token_type == NUM);
 }
 
 //parse_poly_section -> parse_poly_dec_list
@@ -424,83 +862,82 @@ void Parser::parse_poly_section()
     parse_poly_decl_list();
 }
 
-//parse_poly_decl_list -> parse_poly_decl ->(recursively parse_poly_decl)
+//parse_poly_decl_list -> parse_poly_decl -> (parse_poly_decl while the next token is an ID)
 void Parser::parse_poly_decl_list()
 {
-    parse_poly_decl();
-    Token t = lexer.peek(1);
-    if (t.token_type == ID) {
-        parse_poly_decl_list();
-    }
+    do {
+        parse_poly_decl();
+    } while (lexer.peek(1).token_type == ID);
 }
 
 //Semantic Error : reporting error to this function
-void SemanticError::reportError(int code) {
+void SemanticError::reportError(int code, OutputSink& out) {
     if (lines.empty()) return;
     
     // Sort line numbers as required by project spec
     std::sort(lines.begin(), lines.end());
     
-    std::cout << "Semantic Error Code " << code << ": ";
+    out << "Semantic Error Code " << code << ": ";
     for (size_t i = 0; i < lines.size(); i++) {
-        if (i > 0) std::cout << " ";
-        std::cout << lines[i];
+        if (i > 0) out << " ";
+        out << lines[i];
     }
-    std::cout << std::endl;
-    exit(1);
+    out << '\n';
 }
+// Polynomial ids are indexes into polynomial_table and parsed_polynomials.
+// poly_index maps an interned name to the id of its first declaration, so
+// it is a direct array lookup; the interner has already hashed the name.
+int Parser::lookup_polynomial(int name) const {
+    if (name >= 0 && name < (int) poly_index.size())
+        return poly_index[name];
+    return -1;
+}
+
+void Parser::register_polynomial(int name, int poly_id) {
+    if (name >= (int) poly_index.size())
+        poly_index.resize(name + 1, -1);
+    if (poly_index[name] < 0)
+        poly_index[name] = poly_id;
+}
+
 //error 1 :adding duplicate checking function:
-void Parser::check_duplicate_polynomial(const std::string& name, int line_no) {
-   // bool found_duplicate = false;
-
-     for(const auto& poly : polynomial_table) {
-        if(poly.name == name) {
-            semantic_error.lines.push_back(line_no);
-          //  found_duplicate = true;
-          //semantic_error.reportError(1);
-           break;
-            // Don't exit immediately - continue checking for more duplicates
-        }
-    }
-    
+void Parser::check_duplicate_polynomial(int name, int line_no) {
+    // Don't exit immediately - continue checking for more duplicates
+    if (lookup_polynomial(name) >= 0)
+        semantic_error.lines.push_back(line_no);
 }
 //error 2: Checking valid and invalid monomial
-bool Parser::is_valid_monomial(const std::string& monomial_name, const PolynomialDecl& poly) {
-    if (!poly.has_explicit_params) {
-        return monomial_name == "x";
+// A polynomial without a parameter list has the single parameter x
+int Parser::parameter_index(int name, const PolynomialDecl& poly) {
+    for (size_t i = 0; i < poly.parameters.size(); i++) {
+        if (poly.parameters[i] == name) {
+            return (int) i;
+        }
     }
-    return std::find(poly.parameters.begin(), poly.parameters.end(), monomial_name) != poly.parameters.end();
+    return -1;
+}
+
+bool Parser::is_valid_monomial(int monomial_name, const PolynomialDecl& poly) {
+    return parameter_index(monomial_name, poly) >= 0;
 }
 
-void Parser::check_invalid_monomial(const std::string& monomial_name, const PolynomialDecl& current_poly, int line_no) {
+void Parser::check_invalid_monomial(int monomial_name, const PolynomialDecl& current_poly, int line_no) {
     if (!is_valid_monomial(monomial_name, current_poly)) {
         semantic_error2.lines.push_back(line_no);
     }
 }
 //error 3 : checking undeclared polynomial evaluations
-void Parser::check_undeclared_polynomial(const std::string& name, int line_no)
+void Parser::check_undeclared_polynomial(int poly_id, int line_no)
 {
-    bool found = false;
-    for (const auto& poly : polynomial_table) {
-        if (poly.name == name) {
-            found = true;
-            break;
-        }
-    }
-    if (!found) {
+    if (poly_id < 0) {
         semantic_error3.lines.push_back(line_no);
     }
 }
 //error 4: checking wrong numbner of agruments
-void Parser::check_wrong_number_of_arguments(const std::string& name, int line_no, int get_num)
+void Parser::check_wrong_number_of_arguments(int poly_id, int line_no, int get_num)
 {
-    for (const auto& poly : polynomial_table) {
-        if (poly.name == name) {
-            if (poly.parameters.size() != get_num) {
-                semantic_error4.lines.push_back(line_no);
-            }
-            break;
-        }
+    if (poly_id >= 0 && (int) polynomial_table[poly_id].parameters.size() != get_num) {
+        semantic_error4.lines.push_back(line_no);
     }
 }
 
@@ -508,45 +945,30 @@ void Parser::check_wrong_number_of_arguments(const std::string& name, int line_n
 void Parser::parse_poly_decl()
 {   
     Token name_token = lexer.peek(1);  
-    check_duplicate_polynomial(name_token.lexeme, name_token.line_no);
-
-    // Create and store polynomial information
-    current_poly = ParsedPolynomial();  // Reset current polynomial
-    current_poly.name = name_token.lexeme;
-    current_coefficient = 1;  // Reset coefficient
+    if (name_token.token_type != ID)    // parse_poly_name() would reject it anyway
+        syntax_error();
+    check_duplicate_polynomial(name_token.symbol, name_token.line_no);
 
-    PolynomialDecl new_poly;
-    new_poly.name = name_token.lexeme;
+    PolynomialDecl new_poly(arena);
+    new_poly.name = name_token.symbol;
     new_poly.line_no = name_token.line_no;
+    register_polynomial(new_poly.name, polynomial_table.size());
     polynomial_table.push_back(new_poly);
 
     //normal parsing
     parse_poly_header();
     expect(EQUAL);
-    parse_poly_body();
+    struct term_list* body = parse_poly_body();
     expect(SEMICOLON);
 
  // After successful parsing, store the polynomial
-    current_poly.params = polynomial_table.back().parameters;
-    parsed_polynomials.push_back(current_poly);
-
-}
-void Parser::store_polynomial_info() {
     ParsedPolynomial poly;
-    poly.name = polynomial_table.back().name;
-    poly.params = polynomial_table.back().parameters;
-    
-    // Store terms from current polynomial
+    poly.name = new_poly.name;
+    poly.param_count = polynomial_table.back().parameters.size();
+    poly.body = body;
+    CompilePolynomial(body, poly.param_count, arena, poly.code);
     parsed_polynomials.push_back(poly);
-}
 
-void Parser::store_term(int coef, const std::string& var, int exp) {
-    Term term;
-    term.coefficient = coef;
-    term.var = var;
-    term.exponent = exp;
-    term.is_constant = var.empty();
-    parsed_polynomials.back().terms.push_back(term);
 }
 
 //parse_poly_header -> parse_poly_name -> (optionally parse_id_list)
@@ -564,25 +986,28 @@ void Parser::parse_poly_header()
     } else {
         polynomial_table.back().has_explicit_params = false;
         polynomial_table.back().parameters.clear();  // Clear any existing parameters
-        polynomial_table.back().parameters.push_back("x");
+        polynomial_table.back().parameters.push_back(lexer.Intern("x"));
     }
 }
 
-//parse_id_list -> expect(ID) -> (recursively parse_id_list if more IDs)
-void Parser::parse_id_list(std::vector<std::string>& params)
+//parse_id_list -> expect(ID) -> (COMMA expect(ID) while there are more IDs)
+void Parser::parse_id_list(ArenaVector<int>& params)
 {
-    Token t = expect(ID);
-    params.push_back(t.lexeme);
-
+    while (true) {
+        Token t = expect(ID);
+        params.push_back(t.symbol);
 
-    Token next = lexer.peek(1);
-    if (next.token_type == COMMA) {
-        expect(COMMA);
-        parse_id_list(params);
-    }
-    else if (next.token_type != RPAREN) {
-        // If next token is not a comma or right paren, it's a syntax error
-        syntax_error();
+        Token next = lexer.peek(1);
+        if (next.token_type == COMMA) {
+            expect(COMMA);
+        }
+        else if (next.token_type != RPAREN) {
+            // If next token is not a comma or right paren, it's a syntax error
+            syntax_error();
+        }
+        else {
+            break;
+        }
     }
 }
 
@@ -593,125 +1018,125 @@ void Parser::parse_poly_name()
 }
 
 //parse_poly_body -> parse_term_list
-void Parser::parse_poly_body()
+struct term_list* Parser::parse_poly_body()
 {   
-    parse_term_list();
+    return parse_term_list();
 
 }
 
-//parse_term_list -> parse_term -> (optionally parse_add_operator and recursively parse_term_list)
-void Parser::parse_term_list()
+//parse_term_list -> parse_term -> (parse_add_operator parse_term while there are more terms)
+struct term_list* Parser::parse_term_list()
 {   
-    parse_term();
-    Token t = lexer.peek(1);
-    if (t.token_type == PLUS || t.token_type == MINUS) {
+    struct term_list* head = arena.New<struct term_list>();
+    parse_term(head->term);
 
-        parse_add_operator();
-        parse_term_list();
-        
+    struct term_list* tail = head;
+    Token t = lexer.peek(1);
+    while (t.token_type == PLUS || t.token_type == MINUS) {
+        tail->op = parse_add_operator();
+        tail->next = arena.New<struct term_list>();
+        tail = tail->next;
+        parse_term(tail->term);
+        t = lexer.peek(1);
     }
+    return head;
 }
 
 //parse_term -> (optionally parse_coefficient) -> (optionally parse_monomial_list)
-void Parser::parse_term()
+void Parser::parse_term(Term& term)
 {   
   Token t = lexer.peek(1);
     
+    term.monomial_list = NULL;
     if (t.token_type == NUM) {
-        parse_coefficient();
+        term.coefficient = parse_coefficient();
         t = lexer.peek(1);
         if (t.token_type == ID || t.token_type == LPAREN) {
-            parse_monomial_list();
+            term.monomial_list = parse_monomial_list();
         }
     } else {
-        current_coefficient = 1;  // Default coefficient
-        parse_monomial_list();
+        term.coefficient = 1;  // Default coefficient
+        term.monomial_list = parse_monomial_list();
     }
 }
 
-//parse_monomial_list -> parse_monomial -> (recursively parse_monomial_list if more monomials)
-void Parser::parse_monomial_list()
+//parse_monomial_list -> parse_monomial -> (parse_monomial while there are more monomials)
+struct monomial_list* Parser::parse_monomial_list()
 {
-    parse_monomial();
-    Token t = lexer.peek(1);
-    if (t.token_type == ID || t.token_type == LPAREN) {
-        parse_monomial_list();
-    }
+    struct monomial_list* head = NULL;
+    struct monomial_list** link = &head;
+    Token t;
+    do {
+        *link = arena.New<struct monomial_list>();
+        parse_monomial((*link)->monomial);
+        link = &(*link)->next;
+        t = lexer.peek(1);
+    } while (t.token_type == ID || t.token_type == LPAREN);
+    return head;
 }
 
 //parse_monomial -> parse_primary -> (optionally parse_exponent)
-void Parser::parse_monomial()
+void Parser::parse_monomial(Monomial& monomial)
 {
-    parse_primary();
+    monomial.primary = parse_primary();
+    monomial.exponent = 1;
     Token t = lexer.peek(1);
     if (t.token_type == POWER) {
-        parse_exponent();
+        monomial.exponent = parse_exponent();
     }
 }
 
 //parse_primary -> (either expect(ID) or parse parenthesized term_list)
-void Parser::parse_primary()
+Primary* Parser::parse_primary()
 {
+    Primary* primary = arena.New<Primary>();
     Token t = lexer.peek(1);
     if (t.token_type == ID) {
         Token id_token = expect(ID);
 
         // Check for invalid monomial without triggering syntax error
+        primary->kind = VAR;
+        primary->var = -1;      // an invalid monomial evaluates to 0
         if (!polynomial_table.empty()) {  
-            check_invalid_monomial(id_token.lexeme, polynomial_table.back(), id_token.line_no);
+            check_invalid_monomial(id_token.symbol, polynomial_table.back(), id_token.line_no);
+            primary->var = parameter_index(id_token.symbol, polynomial_table.back());
         } 
-        Term term;
-        term.coefficient = current_coefficient;  // Use current coefficient
-        term.var = id_token.lexeme;
-        term.exponent = 1;  // Default exponent
-        term.is_constant = false;
-        current_poly.terms.push_back(term);
-    
 
     //normal parse
         } else if (t.token_type == LPAREN) {
+        enter_nesting();
         expect(LPAREN);
-        parse_term_list();
+        primary->kind = TERM_LIST;
+        primary->t_list = parse_term_list();
         expect(RPAREN);
+        nesting_depth--;
     } else {
         syntax_error();
     }
+    return primary;
 }
 
 
-void Parser::parse_exponent()
+int Parser::parse_exponent()
 {
     expect(POWER);
     Token t = expect(NUM);
-
-    if (!current_poly.terms.empty()) {
-        current_poly.terms.back().exponent = std::atoi(t.lexeme.c_str());
-    }
+    return t.value;
 }
 
-void Parser::parse_add_operator()
+OpType Parser::parse_add_operator()
 {
     Token t = lexer.GetToken();
     if (t.token_type != PLUS && t.token_type != MINUS) {
         syntax_error();
     }
-    if (t.token_type == MINUS && current_poly.terms.size() > 0) {
-        current_poly.terms.back().coefficient *= -1;
-    }
+    return t.token_type == MINUS ? OP_MINUS : OP_PLUS;
 }
 
-void Parser::parse_coefficient()
+int Parser::parse_coefficient()
 {
    Token  t =  expect(NUM);
-  current_coefficient = std::atoi(t.lexeme.c_str());
-  // Store as constant term if no variable follows
-    if (lexer.peek(1).token_type != ID && lexer.peek(1).token_type != LPAREN) {
-        Term term;
-        term.coefficient = current_coefficient;
-        term.is_constant = true;
-        term.exponent = 0;
-        current_poly.terms.push_back(term);
-    }
+   return t.value;
   }
 
 // parse_execute_section -> parse_statement_list
@@ -721,14 +1146,14 @@ void Parser::parse_execute_section()
     parse_statement_list();
 }
 
-//parse_statement_list -> parse_statement -> (recursively parse_statement_list if more statements)
+//parse_statement_list -> parse_statement -> (parse_statement while there are more statements)
 void Parser::parse_statement_list()
 {
-    parse_statement();
-    Token t = lexer.peek(1);
-    if (t.token_type == INPUT || t.token_type == OUTPUT || t.token_type == ID) {
-        parse_statement_list();
-    }
+    Token t;
+    do {
+        parse_statement();
+        t = lexer.peek(1);
+    } while (t.token_type == INPUT || t.token_type == OUTPUT || t.token_type == ID);
 }
 
 void Parser::parse_statement()
@@ -749,23 +1174,13 @@ void Parser::parse_input_statement()
 {
     expect(INPUT);
     Token var_token = expect(ID);
-    int line_no = var_token.line_no;
     expect(SEMICOLON);
 
-     auto it = var_usage.find(var_token.lexeme);
-    if (it != var_usage.end() && it->second.is_assignment && !it->second.used_later) {
-        useless_assignments.push_back(it->second.defined_line);
-    }
-
-
-    mark_variable_defined(var_token.lexeme, var_token.line_no, false);//task 4 -mark as defined
-    mark_variable_initialized(var_token.lexeme);//Task 3 -marking variable as initializes
-    allocate_variable(var_token.lexeme);
-    
     // Store instruction
     Instruction inst;
     inst.type = Instruction::INPUT;
-    inst.var_name = var_token.lexeme;
+    inst.var = allocate_variable(var_token.symbol);
+    inst.line = var_token.line_no;
     instructions.push_back(inst);
 
 }
@@ -776,13 +1191,10 @@ void Parser::parse_output_statement()
     Token var_token = expect(ID);
     expect(SEMICOLON);
 
-    //task 4- mark as used
-    mark_variable_used(var_token.lexeme);
-
     // Store instruction
     Instruction inst;
     inst.type = Instruction::OUTPUT;
-    inst.var_name = var_token.lexeme;
+    inst.var = allocate_variable(var_token.symbol);
     instructions.push_back(inst);
 
   
@@ -793,115 +1205,160 @@ void Parser::parse_assign_statement()
     Token target = expect(ID);
     int assign_line_no = target.line_no; 
     expect(EQUAL);
-    Token poly_name = lexer.peek(1);  // Just peek without consuming
-    
-    parse_poly_evaluation();
+    Instruction inst;
+    inst.type = Instruction::EVAL;
+    parse_poly_evaluation(inst.eval);
     expect(SEMICOLON);
 
-    std::string target_var = target.lexeme;
-    
-    // Store arguments temporarily without marking usage
-    std::vector<std::string> temp_args;
-    
-
     // Add instruction after successful parsing
-    Instruction inst;
-    inst.type = Instruction::EVAL;
-    inst.eval.target_var = target.lexeme;
-    inst.eval.poly_name = poly_name.lexeme;
-    inst.eval.arg_vars = current_args;  // Store collected arguments
+    inst.eval.target = allocate_variable(target.symbol);
+    inst.line = assign_line_no;
     instructions.push_back(inst);
-    allocate_variable(target.lexeme);
-
-    mark_variable_defined(target.lexeme, assign_line_no, true); // task 4 - mark target as defined
-     mark_variable_initialized(target.lexeme);//task 3 -marking target as initializes
-    
-    // Mark all arguments as used
-    for (const auto& arg : current_args) {
-        if (arg != target_var) {  // Don't mark the target variable as used in its own assignment
-            mark_variable_used(arg);
-        }
-    }
-
-    current_args.clear();
-
 }
 
-void Parser::parse_poly_evaluation()
+// Fills in the polynomial id (-1 if it is undeclared) and the arguments of
+// eval; the caller sets the target
+void Parser::parse_poly_evaluation(PolyEvaluation& eval)
 {
-   // parse_poly_name();
-   Token name_token = expect(ID);
-    check_undeclared_polynomial(name_token.lexeme, name_token.line_no); // Check for undeclared polynomial
+    Token name_token = expect(ID);
+    eval.poly_id = lookup_polynomial(name_token.symbol);
+    check_undeclared_polynomial(eval.poly_id, name_token.line_no); // Check for undeclared polynomial
+    enter_nesting();
     expect(LPAREN);
-    int get_num = parse_argument_list();
+    int get_num = parse_argument_list(eval);
     expect(RPAREN);
-    check_wrong_number_of_arguments(name_token.lexeme, name_token.line_no, get_num); // Check for wrong number of arguments
+    nesting_depth--;
+    check_wrong_number_of_arguments(eval.poly_id, name_token.line_no, get_num); // Check for wrong number of arguments
 }
 
-int Parser::parse_argument_list()
+int Parser::parse_argument_list(PolyEvaluation& eval)
 {   
     int count = 1;
-   parse_argument();
-    Token t = lexer.peek(1);
-    if (t.token_type == COMMA) {
+    parse_argument(eval);
+    while (lexer.peek(1).token_type == COMMA) {
         expect(COMMA);
-        count += parse_argument_list();
+        parse_argument(eval);
+        count++;
     }
     
     return count;
 }
 
-void Parser::parse_argument()
+// Temporaries are variables with no name. They hold the value of a literal
+// or of a nested evaluation passed as an argument.
+int Parser::allocate_temporary() {
+    return next_available++;
+}
+
+// Variable arguments are added to eval as they are. A nested evaluation or
+// a number is first stored in a temporary by an instruction of its own,
+// emitted ahead of the evaluation that uses it.
+void Parser::parse_argument(PolyEvaluation& eval)
 {
     Token t = lexer.peek(1);
-    if (t.token_type == ID) {
-        Token t2 = lexer.peek(2);
-        if (t2.token_type == LPAREN){
-            parse_poly_evaluation();
-        }
-        else{
-            Token arg = expect(ID);
-            // Check if argument is initialized
-            check_argument_initialization(arg.lexeme, arg.line_no);
-
-            // Mark the variable as used
-            mark_variable_used(arg.lexeme);
-
-            current_args.push_back(arg.lexeme);
-            }
-        
+    if (t.token_type == ID && lexer.peek(2).token_type != LPAREN) {
+        Token arg = expect(ID);
+        eval.args.push_back(allocate_variable(arg.symbol));
+        eval.arg_lines.push_back(arg.line_no);
     } else if (t.token_type == NUM) {
-        expect(NUM);
+        Instruction inst;
+        inst.type = Instruction::CONST;
+        inst.value = expect(NUM).value;
+        inst.var = allocate_temporary();
+        instructions.push_back(inst);
+        eval.args.push_back(inst.var);
+        eval.arg_lines.push_back(t.line_no);
     } else {
-        parse_poly_evaluation();
-         //syntax_error();
+        Instruction inst;
+        inst.type = Instruction::EVAL;
+        parse_poly_evaluation(inst.eval);
+        inst.eval.target = allocate_temporary();
+        instructions.push_back(inst);
+        eval.args.push_back(inst.eval.target);
+        eval.arg_lines.push_back(t.line_no);
     }
 }
 
 void Parser::parse_inputs_section()
 {
     expect(INPUTS);
-    in_inputs_section = true;
-    parse_num_list();
-    in_inputs_section = false;
+    // the compiled program is only stored if this is the INPUTS the cache
+    // split the source at
+    if (cache && !cached)
+        cacheable = lexer.WindowEmpty() && cache->PrefixLength() != ProgramCache::NO_PREFIX &&
+                    lexer.Offset() - source_offset == cache->PrefixLength() + 6;
+    // the number list is decoded straight into input_values by the lexer
+    // rather than one NUM token at a time
+    if (!lexer.ScanNumberList(input_values))
+        syntax_error();
 }
 
 
 
-int main()
+static void usage()
+{
+    std::cerr << "usage: a.out [--stats] [--jit] [--jit-threshold N] [--memo] [--batch] [--batch-file FILE]\n"
+              << "             [--parallel] [--threads N] [--dse] [--exact] [--mod P]\n"
+              << "             [--cache DIR] < program\n"
+              << "       a.out [options] [--threads N] file-or-directory..." << std::endl;
+    exit(2);
+}
+
+int main(int argc, char* argv[])
 {
+    ExecutionOptions options;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            if (!CollectProgramFiles(argv[i], files)) {
+                std::cerr << "cannot open " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0)
+            options.stats = true;
+        else if (strcmp(argv[i], "--jit") == 0)
+            options.jit = true;
+        else if (strcmp(argv[i], "--jit-threshold") == 0 && i + 1 < argc)
+            options.jit_threshold = atol(argv[++i]);
+        else if (strcmp(argv[i], "--memo") == 0)
+            options.memo = true;
+        else if (strcmp(argv[i], "--batch") == 0)
+            options.batch = true;
+        else if (strcmp(argv[i], "--batch-file") == 0 && i + 1 < argc) {
+            options.batch = true;
+            options.batch_file = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--parallel") == 0)
+            options.parallel = true;
+        else if (strcmp(argv[i], "--dse") == 0)
+            options.dse = true;
+        else if (strcmp(argv[i], "--exact") == 0)
+            options.exact = true;
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            options.cache_dir = argv[++i];
+        else if (strcmp(argv[i], "--mod") == 0 && i + 1 < argc) {
+            // ModularMachine needs 2 <= P < 2^63
+            char* end;
+            options.modulus = strtoull(argv[++i], &end, 10);
+            if (*end != '\0' || options.modulus < 2 || options.modulus >> 63)
+                usage();
+        } else
+            usage();
+    }
+    if (!options.batch_file.empty() && !std::ifstream(options.batch_file.c_str())) {
+        std::cerr << "cannot open " << options.batch_file << std::endl;
+        return 1;
+    }
+    // programs named on the command line run in parallel, each with its own parser
+    if (!files.empty())
+        return RunProgramFiles(files, options, options.threads);
+
     // note: the parser class has a lexer object instantiated in it. You should not be declaring
     // a separate lexer object. You can access the lexer object in the parser functions as shown in the
     // example method Parser::ConsumeAllInput
     // If you declare another lexer object, lexical analysis will not work correctly
-    Parser parser;
-    parser.ConsumeAllInput();
-    //int evaluate_polynomial(const std::string& poly_name, const std::vector<int>& args);
-   
-    //parser.execute_program();
-    //parser.print_symbol_table();
-    //parser.print_input_values();
-
-    return 0;
-
+    OutputSink out;
+    Parser parser(out, options);
+    return parser.ConsumeAllInput();
 }
\ No newline at end of file
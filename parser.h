@@ -7,8 +7,16 @@
 #include <set>
 #include <cmath>
 #include <exception>
+#include <iostream>
 #include <algorithm>
+#include <memory>
 #include "lexer.h"
+#include "arena.h"
+#include "poly.h"
+#include "vm.h"
+#include "outsink.h"
+#include "exact.h"
+#include "progcache.h"
 
 // Enums for different types
 enum PrimaryKind {
@@ -21,7 +29,8 @@ enum OpType {
     OP_MINUS
 };
 
-// Forward declarations for linked structures
+// Forward declarations for linked structures. The nodes are allocated in
+// the parser's arena and are never freed one by one.
 struct term_list;
 struct monomial_list;
 
@@ -47,10 +56,7 @@ struct monomial_list {
 // Represents a term (e.g., 2x^2, -3xy, etc.)
 struct Term {
     int coefficient;
-    bool is_constant;
-    std::string var;     // Variable name for single var terms
-    int exponent;        // Exponent for single var terms
-    struct monomial_list* monomial_list;  // For complex terms
+    struct monomial_list* monomial_list;  // NULL for a constant term
 };
 
 // List of terms with operators between them
@@ -58,38 +64,41 @@ struct term_list {
     Term term;
     OpType op;          // Operator connecting to next term
     struct term_list* next;
-    struct monomial_list* monomial_list;
-
 };
 
 
 //structure for polynomial tracking
 struct PolynomialDecl {
+    explicit PolynomialDecl(Arena& arena)
+        : name(-1), line_no(0), parameters(ArenaAllocator<int>(arena)), has_explicit_params(false) {}
   //checking for Error 1:
-    std::string name;
+    int name;                       // interned
     int line_no;
     //checking for error 2:
-    std::vector<std::string> parameters;  
+    ArenaVector<int> parameters;    // interned parameter names
     bool has_explicit_params; 
-    std::vector<Term> terms;
 };
 
 // structure for error reporting
 struct SemanticError {
     std::vector<int> lines;
-    void reportError(int code);
+    void reportError(int code, OutputSink& out);
     bool has_errors;
 };
 
 struct VariableInfo{
-  int location;
-  std::string name;
+  int location;                     // memory slot once assigned, -1 if never accessed
+  int name;                         // interned
 };
 
+// Variables are referred to by their id until assign_memory_slots() turns
+// the ids into memory slots
 struct PolyEvaluation {
-    std::string target_var;
-    std::string poly_name;
-    std::vector<std::string> arg_vars;
+    PolyEvaluation() : target(-1), poly_id(-1) {}
+    int target;
+    int poly_id;                    // -1 if the polynomial is undeclared
+    std::vector<int> args;
+    std::vector<int> arg_lines;     // line of each argument
 };
 
 //structure for instruction
@@ -97,22 +106,45 @@ struct Instruction {
     enum Type {
         INPUT,
         OUTPUT,
+        CONST,
         EVAL
     } type;
-    std::string var_name;
+    Instruction() : type(INPUT), var(-1), value(0), line(0) {}
+    int var;                        // INPUT, OUTPUT and CONST
+    int value;                      // CONST
+    int line;                       // INPUT and assignments, 0 for a temporary
     PolyEvaluation eval;
 };
 
-struct EvalInfo {
-    std::string target_var;
-    std::string poly_name;
-    std::vector<std::string> arguments;
+struct ParsedPolynomial {
+    int name;                          // interned name of the polynomial
+    int param_count;
+    struct term_list* body;            // AST of the polynomial body, NULL if
+                                       // the program came from the cache
+    CompiledPolynomial code;           // flat form of body that is evaluated
 };
 
-struct ParsedPolynomial {
-    std::string name;                  // Name of polynomial
-    std::vector<Term> terms;          // List of terms
-    std::vector<std::string> params;  // Parameters (if any)
+// deepest nesting of parentheses or polynomial evaluations accepted before
+// the parser reports a syntax error
+#define MAX_NESTING_DEPTH 1000
+
+// Command line options
+struct ExecutionOptions {
+    ExecutionOptions()
+        : stats(false), jit(false), jit_threshold(0), memo(false), batch(false), parallel(false), threads(0),
+          dse(false), exact(false), modulus(0) {}
+    bool stats;         // report execution speed on stderr
+    bool jit;           // compile hot polynomials to native code
+    long jit_threshold; // evaluations after which a polynomial is compiled
+    bool memo;          // cache polynomial results by argument values
+    bool batch;         // run the program once per input record
+    std::string batch_file; // records, one per line; empty for the INPUTS section
+    bool parallel;      // run independent evaluations on several threads
+    int threads;        // threads to use, 0 for one per hardware thread
+    bool dse;           // skip evaluations whose value never reaches an OUTPUT
+    bool exact;         // evaluate without overflow, widening values as needed
+    unsigned long long modulus; // evaluate mod this number, 0 for plain ints
+    std::string cache_dir;  // compiled programs are kept here; empty for none
 };
 
 class SyntaxError : public std::exception {
@@ -122,51 +154,57 @@ class SyntaxError : public std::exception {
 
 class Parser {
   public:
-     void ConsumeAllInput();
-    Parser();
-    void print_symbol_table() const;
-    void print_input_values();
-    void store_input_value(const std::string& num_lexeme);
-     int evaluate_polynomial(const std::string& poly_name, const std::vector<int>& args);
+    // Returns the exit status of the program: 1 if it had errors that were
+    // reported, otherwise 0
+     int ConsumeAllInput();
+    // Everything the program prints goes to out and the program is read
+    // from fd, so any number of parsers can run at once. The AST is built
+    // in arena if one is given, which must then outlive the parser, and
+    // otherwise in an arena of the parser's own.
+    explicit Parser(OutputSink& out, const ExecutionOptions& options = ExecutionOptions(), int fd = 0,
+                    Arena* arena = NULL);
     void execute_program();
 
 
   private:
+    ExecutionOptions options;
+    OutputSink& out;
+    void execute_batch(const std::vector<const CompiledPolynomial*>& polys);
+    void compile_exact(std::vector<ExactPolynomial>& exact, std::vector<const ExactPolynomial*>& polys);
+    void execute_exact();
+    void execute_modular();
+
+    // Program cache. Everything up to the INPUTS keyword is compiled into
+    // bytecode, the polynomial table and the warning and error lines, which
+    // are stored under a hash of that text. A later run of the same text
+    // loads them and only parses INPUTS.
+    std::unique_ptr<ProgramCache> cache;
+    bool cached;                // the program was loaded from the cache
+    bool cacheable;             // it parsed and its INPUTS is where the cache found it
+    size_t source_offset;       // lexer offset of the start of the program
+    std::vector<ExactPolynomial> cached_exact;  // exact forms, as there are no ASTs
+    void open_cache();
+    bool load_cached_program();
+    void store_cached_program();
     LexicalAnalyzer lexer;
+    Arena own_arena;
+    Arena& arena;       // owns the AST of every polynomial in the program
     void syntax_error();
     Token expect(TokenType expected_type);
-    struct term_list* current_term_list;
+    int nesting_depth;
+    void enter_nesting();
 
     bool tasks[7] = {false}; 
     void processTaskNumber(int num); 
-    void executeAllTasks();
+    int executeAllTasks();
     
-//task 3 tracking initialized variable
-    std::set<std::string> initialized_vars;
-     std::vector<int> warning_lines;
-    
-    // Helper functions for warning code 1
-    void mark_variable_initialized(const std::string& var_name);
-    void check_argument_initialization(const std::string& arg_name, int line_no);
-    void report_warning_code_1();
-
-// Task 4-> Add warning code 2 members
-  struct VarUsage{ 
-   int defined_line;
-    bool is_assignment;
-    bool used_later;
-    
-    VarUsage() : defined_line(0), is_assignment(false), used_later(false) {}
-    VarUsage(int line, bool assignment) : 
-        defined_line(line), is_assignment(assignment), used_later(false) {}
-    };
-    std::map<std::string, VarUsage> var_usage;
+// Warning codes 1 and 2 are found by dataflow over the instructions,
+    // before assign_memory_slots() turns variable ids into slots
+    std::vector<int> warning_lines;
     std::vector<int> useless_assignments;
-
-    // Add warning code 2 helper functions
-    void mark_variable_defined(const std::string& var_name, int line_no, bool is_assignment);
-    void mark_variable_used(const std::string& var_name);
-    void check_useless_assignments();
+    void find_uninitialized_arguments();
+    void find_useless_assignments();
+    void report_warning_code_1();
     void report_warning_code_2();
 
     // Storage
@@ -175,29 +213,25 @@ class Parser {
     std::vector<int> input_values;
     std::vector<Instruction> instructions;
     std::vector<PolynomialDecl> polynomial_table;
-    std::vector<std::string> current_args;
+    std::vector<int> var_slot;      // interned name -> variable id, -1 if none
     std::vector<ParsedPolynomial> parsed_polynomials;
+    std::vector<int> poly_index;    // interned name -> polynomial id, -1 if none
 
-    
-    int current_coefficient = 1;
-    ParsedPolynomial current_poly;
-   
-    bool in_inputs_section = false;
 
     // Counters
     int next_available;
-    int current_input_index;
     
 
     // fucntions for task 2
-    int allocate_variable(const std::string& var_name);
-    int get_next_input();
-   
-    void store_poly_eval_instruction(const std::string& target_var, const std::string& poly_name, const std::vector<std::string>& args);
-    void store_polynomial_info() ;
-    void store_term(int coef, const std::string& var, int exp);
+    int allocate_variable(int name);
+    int allocate_temporary();
+    int eliminate_dead_stores();
+    void assign_memory_slots();
+    void compile_bytecode();
+    void compile_program();
+    Bytecode bytecode;
+    int dead_stores;                // evaluations removed by --dse
     //data members for semantic checking
-    //std::vector<int> duplicate_lines;
     
     SemanticError semantic_error;// Error 1
     SemanticError semantic_error2; // Error 2
@@ -205,20 +239,15 @@ class Parser {
     SemanticError semantic_error4; // Error 3
   
 
-  //polynomial evaluation
-  int evaluate_primary(const Primary* primary, const std::vector<std::string>& params, const std::vector<int>& args);
-    int evaluate_monomial(const Monomial& monomial, const std::vector<std::string>& params, const std::vector<int>& args);
-    int evaluate_monomial_list(const struct monomial_list* list, const std::vector<std::string>& params, const std::vector<int>& args);
-    int evaluate_term(const Term& term, const std::vector<std::string>& params, const std::vector<int>& args);
-    int evaluate_term_list(const struct term_list* list, const std::vector<std::string>& params, const std::vector<int>& args);
-   
-
     //funtion for Semantic errors
-    void check_duplicate_polynomial(const std::string& name, int line_no);
-    void check_invalid_monomial(const std::string& monomial_name, const PolynomialDecl& current_poly, int line_no);
-    bool is_valid_monomial(const std::string& monomial_name, const PolynomialDecl& poly);
-    void check_undeclared_polynomial(const std::string& name, int line_no);
-    void check_wrong_number_of_arguments(const std::string& name, int line_no, int get_num);
+    int lookup_polynomial(int name) const;
+    void register_polynomial(int name, int poly_id);
+    void check_duplicate_polynomial(int name, int line_no);
+    void check_invalid_monomial(int monomial_name, const PolynomialDecl& current_poly, int line_no);
+    bool is_valid_monomial(int monomial_name, const PolynomialDecl& poly);
+    int parameter_index(int name, const PolynomialDecl& poly);
+    void check_undeclared_polynomial(int poly_id, int line_no);
+    void check_wrong_number_of_arguments(int poly_id, int line_no, int get_num);
 
     void parse_tasks_section();
         void parse_num_list();
@@ -226,26 +255,26 @@ class Parser {
         void parse_poly_decl_list();
         void parse_poly_decl();
         void parse_poly_header();
-        void parse_id_list(std::vector<std::string>& params);
+        void parse_id_list(ArenaVector<int>& params);
         void parse_poly_name();
-        void parse_poly_body();
-        void parse_term_list();
-        void parse_term();
-        void parse_monomial_list();
-        void parse_monomial();
-        void parse_primary();
-        void parse_exponent();
-        void parse_add_operator();
-        void parse_coefficient();
+        struct term_list* parse_poly_body();
+        struct term_list* parse_term_list();
+        void parse_term(Term& term);
+        struct monomial_list* parse_monomial_list();
+        void parse_monomial(Monomial& monomial);
+        Primary* parse_primary();
+        int parse_exponent();
+        OpType parse_add_operator();
+        int parse_coefficient();
         void parse_execute_section();
         void parse_statement_list();
         void parse_statement();
         void parse_input_statement();
         void parse_output_statement();
         void parse_assign_statement();
-        void parse_poly_evaluation();
-        int parse_argument_list();
-        void parse_argument();
+        void parse_poly_evaluation(PolyEvaluation& eval);
+        int parse_argument_list(PolyEvaluation& eval);
+        void parse_argument(PolyEvaluation& eval);
         void parse_inputs_section();
 };
 
@@ -0,0 +1,513 @@
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+#include <cstring>
+
+#include "poly.h"
+#include "parser.h"
+
+using namespace std;
+
+namespace {
+
+struct Factor {
+    int slot;
+    int exponent;
+    bool operator<(const Factor& other) const
+    {
+        return slot != other.slot ? slot < other.slot : exponent < other.exponent;
+    }
+    bool operator==(const Factor& other) const { return slot == other.slot && exponent == other.exponent; }
+};
+
+struct FlatTerm {
+    unsigned coefficient;
+    vector<Factor> factors;     // sorted by slot, one entry per slot
+    bool operator<(const FlatTerm& other) const { return factors < other.factors; }
+};
+
+typedef vector<FlatTerm> FlatSum;
+
+// Exponentiation by squaring: about 2 log2(exponent) multiplies
+inline unsigned PowerOf(unsigned base, int exponent)
+{
+    unsigned result = 1;
+    for (unsigned e = exponent; e != 0; e >>= 1) {
+        if (e & 1)
+            result *= base;
+        base *= base;
+    }
+    return result;
+}
+
+// Sorts the factors of a term and combines repeated slots, x x^2 -> x^3.
+// Exponents are only added while the sum fits in an int.
+void NormalizeFactors(vector<Factor>& factors)
+{
+    sort(factors.begin(), factors.end());
+    size_t out = 0;
+    for (size_t i = 0; i < factors.size(); i++) {
+        if (out > 0 && factors[out-1].slot == factors[i].slot &&
+            factors[out-1].exponent <= INT_MAX - factors[i].exponent)
+            factors[out-1].exponent += factors[i].exponent;
+        else
+            factors[out++] = factors[i];
+    }
+    factors.resize(out);
+}
+
+// Adds up terms with the same factors and drops terms whose coefficient is 0
+void MergeTerms(FlatSum& sum)
+{
+    stable_sort(sum.begin(), sum.end());
+    size_t out = 0;
+    for (size_t i = 0; i < sum.size(); i++) {
+        if (out > 0 && sum[out-1].factors == sum[i].factors)
+            sum[out-1].coefficient += sum[i].coefficient;
+        else
+            sum[out++] = sum[i];
+    }
+    sum.resize(out);
+
+    out = 0;
+    for (size_t i = 0; i < sum.size(); i++) {
+        if (sum[i].coefficient != 0)
+            sum[out++] = sum[i];
+    }
+    sum.resize(out);
+}
+
+class PolynomialCompiler {
+  public:
+    explicit PolynomialCompiler(int params) : param_count(params) {}
+
+    // Compiles a term list into sums and returns its index
+    int CompileSum(const struct term_list* list);
+
+    int param_count;
+    vector<FlatSum> sums;
+
+  private:
+    bool CompileTerm(const Term& term, FlatTerm& out);
+};
+
+// Returns false if the term is always 0, which happens when it uses a name
+// that is not a parameter of the polynomial.
+bool PolynomialCompiler::CompileTerm(const Term& term, FlatTerm& out)
+{
+    out.coefficient = (unsigned) term.coefficient;
+    out.factors.clear();
+
+    for (const struct monomial_list* m = term.monomial_list; m; m = m->next) {
+        const Primary* primary = m->monomial.primary;
+        int exponent = m->monomial.exponent;
+        if (exponent <= 0)      // x^0 is 1, as is 0^0
+            continue;
+
+        if (primary->kind == VAR) {
+            if (primary->var < 0)
+                return false;
+            Factor f = { primary->var, exponent };
+            out.factors.push_back(f);
+            continue;
+        }
+
+        int sub = CompileSum(primary->t_list);
+        if (sums[sub].empty())
+            return false;
+        if (sums[sub].size() == 1 && sub == (int) sums.size() - 1) {
+            // (c f1 f2 ...)^e folds into c^e f1^e f2^e ...
+            const FlatTerm& inner = sums[sub][0];
+            bool fits = true;
+            for (size_t i = 0; i < inner.factors.size(); i++)
+                fits = fits && inner.factors[i].exponent <= INT_MAX / exponent;
+            if (fits) {
+                out.coefficient *= PowerOf(inner.coefficient, exponent);
+                for (size_t i = 0; i < inner.factors.size(); i++) {
+                    Factor f = { inner.factors[i].slot, inner.factors[i].exponent * exponent };
+                    out.factors.push_back(f);
+                }
+                sums.pop_back();
+                continue;
+            }
+        }
+        Factor f = { param_count + sub, exponent };
+        out.factors.push_back(f);
+    }
+    NormalizeFactors(out.factors);
+    return true;
+}
+
+int PolynomialCompiler::CompileSum(const struct term_list* list)
+{
+    FlatSum sum;
+    FlatTerm term;
+    bool negate = false;
+
+    for (; list; list = list->next) {
+        if (CompileTerm(list->term, term)) {
+            if (negate)
+                term.coefficient = 0u - term.coefficient;
+            sum.push_back(term);
+        }
+        negate = list->op == OP_MINUS;
+    }
+    MergeTerms(sum);
+    sums.push_back(sum);
+    return (int) sums.size() - 1;
+}
+
+template <class T>
+const T* CopyToArena(const vector<T>& v, Arena& arena)
+{
+    T* p = (T*) arena.Allocate(v.size() * sizeof(T) + 1, alignof(T));
+    if (!v.empty())
+        memcpy(p, &v[0], v.size() * sizeof(T));
+    return p;
+}
+
+// A value in the evaluation table, before the table is laid out
+struct Ref {
+    enum Kind { PARAM, POWER, CONSTANT, TEMP } kind;
+    int index;
+};
+
+// HornerBuilder rewrites the sums of a polynomial into nested Horner form.
+// The slot v that appears in the most terms is factored out, and the terms
+// are grouped by their exponent of v, e0 = 0 < e1 < ... < em:
+//   P = R0 + v^e1 (R1 + v^(e2-e1) (R2 + ... + v^(em-em-1) Rm))
+// where Rj has the terms with v^ej, with v divided out, and each Rj is
+// rewritten the same way. Each level of the chain is one multiply-add step,
+// so a sum costs about one multiply and one add per term whatever its
+// exponents. The powers go in a table that is filled once per evaluation,
+// each from the previous power of the same base.
+//
+// The terms are grouped in place and the groups are passed down as index
+// ranges. No group contains v any more, so the recursion is at most as deep
+// as the number of distinct slots in the sum, and each term is visited once
+// per level.
+class HornerBuilder {
+  public:
+    explicit HornerBuilder(int param_count) : param_count(param_count), temp_count(0)
+    {
+        Constant(0);
+        Constant(1);
+    }
+
+    // Returns the value of terms [begin, end), which it may reorder and
+    // divide; slot_ref maps the slots the terms use to values
+    Ref Emit(vector<FlatTerm>& terms, size_t begin, size_t end, const vector<Ref>& slot_ref);
+
+    int param_count;
+    vector<int> constants;
+    vector<Factor> powers;          // base slot and exponent
+    vector<Ref> power_base;
+    vector<int> steps;              // four Refs per step, flattened to kind/index pairs
+    int temp_count;
+
+  private:
+    Ref Power(int slot, int exponent, const vector<Ref>& slot_ref);
+    Ref Constant(unsigned value);
+    // q * power + r, or power alone when q is 1 and r is 0
+    Ref Step(Ref q, Ref power, Ref r);
+    Ref EmitProduct(const FlatTerm& term, const vector<Ref>& slot_ref);
+
+    unordered_map<unsigned long long, int> power_index;    // slot << 32 | exponent
+    unordered_map<unsigned, int> constant_index;
+    vector<int> uses;               // terms using each slot, while picking v
+};
+
+// v^1 is v itself and takes no entry in the power table
+Ref HornerBuilder::Power(int slot, int exponent, const vector<Ref>& slot_ref)
+{
+    if (exponent == 1)
+        return slot_ref[slot];
+
+    Factor f = { slot, exponent };
+    unsigned long long key = (unsigned long long) slot << 32 | (unsigned) exponent;
+    auto inserted = power_index.insert(make_pair(key, (int) powers.size()));
+    Ref ref = { Ref::POWER, inserted.first->second };
+    if (inserted.second) {
+        powers.push_back(f);
+        power_base.push_back(slot_ref[slot]);
+    }
+    return ref;
+}
+
+Ref HornerBuilder::Constant(unsigned value)
+{
+    auto inserted = constant_index.insert(make_pair(value, (int) constants.size()));
+    Ref ref = { Ref::CONSTANT, inserted.first->second };
+    if (inserted.second)
+        constants.push_back((int) value);
+    return ref;
+}
+
+Ref HornerBuilder::Step(Ref q, Ref power, Ref r)
+{
+    if (q.kind == Ref::CONSTANT && q.index == 1 && r.kind == Ref::CONSTANT && r.index == 0)
+        return power;       // a bare v^k needs no step
+
+    Ref dst = { Ref::TEMP, temp_count++ };
+    Ref operands[4] = { dst, q, power, r };
+    for (int i = 0; i < 4; i++) {
+        steps.push_back(operands[i].kind);
+        steps.push_back(operands[i].index);
+    }
+    return dst;
+}
+
+// A single term is a chain of multiplies, one per factor
+Ref HornerBuilder::EmitProduct(const FlatTerm& term, const vector<Ref>& slot_ref)
+{
+    Ref zero = { Ref::CONSTANT, 0 };
+    Ref value = Constant(term.coefficient);
+    for (size_t f = 0; f < term.factors.size(); f++)
+        value = Step(value, Power(term.factors[f].slot, term.factors[f].exponent, slot_ref), zero);
+    return value;
+}
+
+// The exponent of slot in a term, 0 if the term does not use it
+static int ExponentOf(const FlatTerm& term, int slot)
+{
+    Factor key = { slot, 0 };
+    auto f = lower_bound(term.factors.begin(), term.factors.end(), key);
+    return f != term.factors.end() && f->slot == slot ? f->exponent : 0;
+}
+
+Ref HornerBuilder::Emit(vector<FlatTerm>& terms, size_t begin, size_t end, const vector<Ref>& slot_ref)
+{
+    if (end - begin == 1)
+        return EmitProduct(terms[begin], slot_ref);
+
+    // the slot used by the most terms, the lowest on a tie; a sum where no
+    // term has a factor left is a constant
+    if (uses.size() < slot_ref.size())
+        uses.resize(slot_ref.size(), 0);
+    int slot = -1;
+    unsigned constant = 0;
+    for (size_t t = begin; t < end; t++) {
+        constant += terms[t].coefficient;
+        for (size_t f = 0; f < terms[t].factors.size(); f++) {
+            int s = terms[t].factors[f].slot;
+            uses[s]++;
+            if (slot < 0 || uses[s] > uses[slot] || (uses[s] == uses[slot] && s < slot))
+                slot = s;
+        }
+    }
+    for (size_t t = begin; t < end; t++) {
+        for (size_t f = 0; f < terms[t].factors.size(); f++)
+            uses[terms[t].factors[f].slot] = 0;
+    }
+    if (slot < 0)
+        return Constant(constant);
+
+    // group by the exponent of v and divide it out
+    sort(terms.begin() + begin, terms.begin() + end, [slot](const FlatTerm& a, const FlatTerm& b) {
+        return ExponentOf(a, slot) < ExponentOf(b, slot);
+    });
+    vector<int> exponents(end - begin);
+    for (size_t t = begin; t < end; t++) {
+        vector<Factor>& factors = terms[t].factors;
+        Factor key = { slot, 0 };
+        auto f = lower_bound(factors.begin(), factors.end(), key);
+        if (f != factors.end() && f->slot == slot) {
+            exponents[t - begin] = f->exponent;
+            factors.erase(f);
+        }
+    }
+
+    // innermost group first, each step multiplies by the gap to the next
+    size_t group_end = end;
+    Ref value = { Ref::CONSTANT, 0 };
+    bool first = true;
+    while (true) {
+        int e = exponents[group_end - 1 - begin];
+        size_t group_begin = group_end;
+        while (group_begin > begin && exponents[group_begin - 1 - begin] == e)
+            group_begin--;
+        Ref r = Emit(terms, group_begin, group_end, slot_ref);
+        if (first)
+            value = r;
+        else
+            value = Step(value, Power(slot, exponents[group_end - begin] - e, slot_ref), r);
+        first = false;
+        if (group_begin == begin) {
+            if (e > 0)
+                value = Step(value, Power(slot, e, slot_ref), Constant(0));
+            return value;
+        }
+        group_end = group_begin;
+    }
+}
+
+}  // namespace
+
+void CompilePolynomial(const struct term_list* body, int param_count, Arena& arena, CompiledPolynomial& out)
+{
+    PolynomialCompiler compiler(param_count);
+    compiler.CompileSum(body);
+
+    vector<int> sum_begin, coefficients, term_begin, factor_slot, factor_exponent;
+    for (size_t s = 0; s < compiler.sums.size(); s++) {
+        sum_begin.push_back(coefficients.size());
+        const FlatSum& sum = compiler.sums[s];
+        for (size_t t = 0; t < sum.size(); t++) {
+            term_begin.push_back(factor_slot.size());
+            coefficients.push_back((int) sum[t].coefficient);
+            for (size_t f = 0; f < sum[t].factors.size(); f++) {
+                factor_slot.push_back(sum[t].factors[f].slot);
+                factor_exponent.push_back(sum[t].factors[f].exponent);
+            }
+        }
+    }
+    sum_begin.push_back(coefficients.size());
+    term_begin.push_back(factor_slot.size());
+
+    out.param_count = param_count;
+    out.sum_count = compiler.sums.size();
+    out.slot_count = param_count + out.sum_count - 1;
+    out.term_count = coefficients.size();
+    out.factor_count = factor_slot.size();
+    out.sum_begin = CopyToArena(sum_begin, arena);
+    out.coefficients = CopyToArena(coefficients, arena);
+    out.term_begin = CopyToArena(term_begin, arena);
+    out.factor_slot = CopyToArena(factor_slot, arena);
+    out.factor_exponent = CopyToArena(factor_exponent, arena);
+    BuildHornerProgram(out, arena);
+}
+
+void BuildHornerProgram(CompiledPolynomial& p, Arena& arena)
+{
+    HornerBuilder builder(p.param_count);
+    vector<int> power_begin, step_begin;
+    vector<Ref> slot_ref, sum_result;
+
+    for (int i = 0; i < p.param_count; i++) {
+        Ref param = { Ref::PARAM, i };
+        slot_ref.push_back(param);
+    }
+    for (int s = 0; s < p.sum_count; s++) {
+        vector<FlatTerm> terms(p.sum_begin[s+1] - p.sum_begin[s]);
+        for (int t = p.sum_begin[s]; t < p.sum_begin[s+1]; t++) {
+            FlatTerm& term = terms[t - p.sum_begin[s]];
+            term.coefficient = (unsigned) p.coefficients[t];
+            for (int f = p.term_begin[t]; f < p.term_begin[t+1]; f++) {
+                Factor factor = { p.factor_slot[f], p.factor_exponent[f] };
+                term.factors.push_back(factor);
+            }
+        }
+        power_begin.push_back(builder.powers.size());
+        step_begin.push_back(builder.steps.size() / 8);
+        Ref result = builder.Emit(terms, 0, terms.size(), slot_ref);
+        sum_result.push_back(result);
+        slot_ref.push_back(result);     // the slot of a sub-expression
+    }
+    power_begin.push_back(builder.powers.size());
+    step_begin.push_back(builder.steps.size() / 8);
+
+    // Lay out the table. Within a sum the powers of one base are ordered by
+    // exponent, so each is computed from the one before.
+    int power_count = builder.powers.size();
+    int constant_base = p.param_count + power_count;
+    int temp_base = constant_base + builder.constants.size();
+    vector<int> power_index(power_count);
+    vector<int> power_base(power_count), power_step(power_count), power_previous(power_count);
+
+    for (int s = 0; s < p.sum_count; s++) {
+        vector<int> order;
+        for (int i = power_begin[s]; i < power_begin[s+1]; i++)
+            order.push_back(i);
+        const vector<Factor>& powers = builder.powers;
+        sort(order.begin(), order.end(), [&powers](int a, int b) {
+            return powers[a].slot != powers[b].slot ? powers[a].slot < powers[b].slot
+                                                    : powers[a].exponent < powers[b].exponent;
+        });
+        for (size_t i = 0; i < order.size(); i++)
+            power_index[order[i]] = power_begin[s] + i;
+    }
+
+    auto place = [&](const Ref& ref) {
+        switch (ref.kind) {
+            case Ref::PARAM:    return ref.index;
+            case Ref::POWER:    return p.param_count + power_index[ref.index];
+            case Ref::CONSTANT: return constant_base + ref.index;
+            default:            return temp_base + ref.index;
+        }
+    };
+
+    vector<Factor> sorted(power_count);
+    for (int i = 0; i < power_count; i++) {
+        int at = power_index[i];
+        power_base[at] = place(builder.power_base[i]);
+        sorted[at] = builder.powers[i];
+    }
+    for (int s = 0; s < p.sum_count; s++) {
+        for (int at = power_begin[s]; at < power_begin[s+1]; at++) {
+            bool chained = at > power_begin[s] && sorted[at].slot == sorted[at-1].slot;
+            power_step[at] = chained ? sorted[at].exponent - sorted[at-1].exponent : sorted[at].exponent;
+            power_previous[at] = chained ? p.param_count + at - 1 : constant_base + 1;
+        }
+    }
+
+    vector<int> steps;
+    for (size_t i = 0; i < builder.steps.size(); i += 2) {
+        Ref ref = { (Ref::Kind) builder.steps[i], builder.steps[i+1] };
+        steps.push_back(place(ref));
+    }
+    vector<int> result;
+    for (int s = 0; s < p.sum_count; s++)
+        result.push_back(place(sum_result[s]));
+
+    p.scratch_size = temp_base + builder.temp_count;
+    p.power_count = power_count;
+    p.constant_count = builder.constants.size();
+    p.constants = CopyToArena(builder.constants, arena);
+    p.power_begin = CopyToArena(power_begin, arena);
+    p.power_base = CopyToArena(power_base, arena);
+    p.power_step = CopyToArena(power_step, arena);
+    p.power_previous = CopyToArena(power_previous, arena);
+    p.step_begin = CopyToArena(step_begin, arena);
+    p.steps = CopyToArena(steps, arena);
+    p.sum_result = CopyToArena(result, arena);
+}
+
+void PrepareScratch(const CompiledPolynomial& p, unsigned* scratch)
+{
+    unsigned* constant = scratch + p.param_count + p.power_count;
+    for (int i = 0; i < p.constant_count; i++)
+        constant[i] = (unsigned) p.constants[i];
+}
+
+// Runs the steps of each sum once the parameters are in scratch, which is
+// the evaluation table. Every step has the same shape, so there is nothing
+// to dispatch on.
+static inline int EvaluateSums(const CompiledPolynomial& p, unsigned* t)
+{
+    for (int s = 0; s < p.sum_count; s++) {
+        for (int i = p.power_begin[s]; i < p.power_begin[s+1]; i++)
+            t[p.param_count + i] = PowerOf(t[p.power_base[i]], p.power_step[i]) * t[p.power_previous[i]];
+
+        const int* step = p.steps + 4 * p.step_begin[s];
+        const int* end = p.steps + 4 * p.step_begin[s+1];
+        for (; step < end; step += 4)
+            t[step[0]] = t[step[1]] * t[step[2]] + t[step[3]];
+    }
+    return (int) t[p.sum_result[p.sum_count - 1]];
+}
+
+int EvaluateCompiled(const CompiledPolynomial& p, const int* args, int argc, unsigned* scratch)
+{
+    for (int i = 0; i < p.param_count; i++)
+        scratch[i] = i < argc ? (unsigned) args[i] : 0;
+    PrepareScratch(p, scratch);
+    return EvaluateSums(p, scratch);
+}
+
+int EvaluateGathered(const CompiledPolynomial& p, const int* mem, const int* arg_slots, int argc, unsigned* scratch)
+{
+    for (int i = 0; i < p.param_count; i++)
+        scratch[i] = i < argc ? (unsigned) mem[arg_slots[i]] : 0;
+    return EvaluateSums(p, scratch);
+}
@@ -0,0 +1,66 @@
+#ifndef __POLY__H__
+#define __POLY__H__
+
+#include "arena.h"
+
+struct term_list;
+
+// CompiledPolynomial is the flat form of a polynomial body that evaluation
+// runs on. It is a sequence of sums. Each sum is a run of terms, each term
+// a coefficient times a run of factors, and each factor a slot raised to an
+// exponent. Slots 0 .. param_count-1 hold the arguments. A parenthesized
+// sub-expression becomes a sum of its own whose value is stored in slot
+// param_count + (its sum index), so sums are laid out innermost first and
+// the last sum is the value of the polynomial. All arrays live in the arena
+// the polynomial was compiled into.
+struct CompiledPolynomial {
+    int param_count;
+    int slot_count;             // param_count + sum_count - 1
+    int sum_count;
+    int term_count;
+    int factor_count;
+    const int* sum_begin;       // sum_count + 1 offsets into the term arrays
+    const int* coefficients;    // one per term
+    const int* term_begin;      // term_count + 1 offsets into the factor arrays
+    const int* factor_slot;     // one per factor
+    const int* factor_exponent; // one per factor, always positive
+
+    // The form that is evaluated, built by BuildHornerProgram(). Every sum
+    // is rewritten into nested Horner form as a list of multiply-add steps
+    //   t[dst] = t[q] * t[power] + t[r]
+    // over one table of values t: the parameters, then a table of powers
+    // filled once per evaluation, then the constants, then temporaries.
+    int scratch_size;           // size of t
+    int power_count;
+    int constant_count;
+    const int* constants;       // copied to t[param_count + power_count] on
+                                // each evaluation; constants[0] is 0, [1] is 1
+    const int* power_begin;     // sum_count + 1 offsets into the power arrays
+    const int* power_base;      // t index of the value raised
+    const int* power_step;      // exponent over power_previous
+    const int* power_previous;  // t index of an earlier power of the same base,
+                                // or of the constant 1
+    const int* step_begin;      // sum_count + 1 offsets into steps, in steps
+    const int* steps;           // dst, q, power, r for each step
+    const int* sum_result;      // t index of the value of each sum
+};
+
+// Compiles the AST of a polynomial body. Terms of a sum that multiply the
+// same factors are merged, and a sub-expression with a single term is
+// folded into the term that uses it.
+void CompilePolynomial(const struct term_list* body, int param_count, Arena& arena, CompiledPolynomial& out);
+
+// Builds the Horner form of p from its sums. CompilePolynomial() calls it;
+// it is only needed for a CompiledPolynomial put together by hand.
+void BuildHornerProgram(CompiledPolynomial& p, Arena& arena);
+
+// Evaluates p with 32-bit wrap-around arithmetic. Arguments past argc count
+// as 0. scratch must have room for p.scratch_size values.
+int EvaluateCompiled(const CompiledPolynomial& p, const int* args, int argc, unsigned* scratch);
+// Same, with argument i read from mem[arg_slots[i]]. scratch must have been
+// set up for p by PrepareScratch() and not used for another polynomial
+// since, so a caller can keep one table per polynomial and prepare it once.
+void PrepareScratch(const CompiledPolynomial& p, unsigned* scratch);
+int EvaluateGathered(const CompiledPolynomial& p, const int* mem, const int* arg_slots, int argc, unsigned* scratch);
+
+#endif  //__POLY__H__
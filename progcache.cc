@@ -0,0 +1,231 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "progcache.h"
+#include "charclass.h"
+
+using namespace std;
+
+// bumped whenever the layout of an entry changes
+#define PROGRAM_CACHE_VERSION 3
+#define PROGRAM_CACHE_MAGIC 0x43594c50      // "PLYC"
+
+namespace {
+
+// An entry is the header, the source text it was compiled from, padded to
+// a multiple of 8 bytes, and then the payload
+struct Header {
+    unsigned magic;
+    unsigned version;
+    unsigned flags;
+    unsigned reserved;
+    unsigned long long prefix_length;
+    unsigned long long hash;
+    unsigned long long payload_count;   // ints after the source text
+    unsigned long long checksum;        // HashBytes() of the payload
+};
+
+}  // namespace
+
+static size_t PaddedLength(size_t prefix_length)
+{
+    return (prefix_length + 7) & ~(size_t) 7;
+}
+
+// The first INPUTS that is a word on its own. If the text before it does
+// not lex the way it looks, for example when it ends inside an identifier,
+// the parser finds its INPUTS keyword somewhere else and does not cache the
+// program.
+static size_t FindInputsKeyword(const char* source, size_t len)
+{
+    const char* p = source;
+    const char* end = source + len;
+    while (const char* hit = (const char*) memmem(p, end - p, "INPUTS", 6)) {
+        bool starts = hit == source || !IsAlnumChar(hit[-1]);
+        bool ends = hit + 6 == end || !IsAlnumChar(hit[6]);
+        if (starts && ends)
+            return hit - source;
+        p = hit + 1;
+    }
+    return ProgramCache::NO_PREFIX;
+}
+
+// 64-bit multiply-xorshift hash, eight bytes per step. It names entries
+// after their source, which is then compared in full, and checksums their
+// payload.
+static unsigned long long HashBytes(const char* p, size_t len)
+{
+    const unsigned long long k = 0x9e3779b97f4a7c15ULL;
+    unsigned long long h = len * k;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        unsigned long long w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * k;
+        h ^= h >> 29;
+    }
+    unsigned long long w = 0;
+    memcpy(&w, p + i, len - i);
+    h = (h ^ w) * k;
+    h ^= h >> 32;
+    h *= k;
+    return h ^ (h >> 29);
+}
+
+ProgramCache::ProgramCache(const string& dir, const char* source, size_t len, unsigned flags)
+    : prefix_length(FindInputsKeyword(source, len)), hash(0), flags(flags),
+      mapping(NULL), mapping_size(0), next(NULL), end(NULL), failed(false)
+{
+    if (prefix_length == NO_PREFIX)
+        return;
+    prefix.assign(source, prefix_length);
+    hash = HashBytes(source, prefix_length);
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx-%x.pc", hash, flags);
+    path = dir + name;
+}
+
+ProgramCache::~ProgramCache()
+{
+    if (mapping)
+        munmap(mapping, mapping_size);
+}
+
+bool ProgramCache::Open()
+{
+    if (prefix_length == NO_PREFIX)
+        return false;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(Header))
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+
+    // two programs whose text hashes the same must not share an entry, so
+    // the text it was compiled from has to match byte for byte
+    const Header* h = (const Header*) p;
+    const char* text = (const char*) (h + 1);
+    size_t text_bytes = PaddedLength(prefix_length);
+    size_t payload_bytes = st.st_size - sizeof(Header) - text_bytes;
+    if (h->magic != PROGRAM_CACHE_MAGIC || h->version != PROGRAM_CACHE_VERSION || h->flags != flags ||
+        h->prefix_length != prefix_length || h->hash != hash ||
+        (size_t) st.st_size - sizeof(Header) < text_bytes || memcmp(text, prefix.data(), prefix_length) != 0 ||
+        h->payload_count != payload_bytes / sizeof(int) || payload_bytes % sizeof(int) != 0 ||
+        h->checksum != HashBytes(text + text_bytes, payload_bytes)) {
+        munmap(p, st.st_size);
+        return false;
+    }
+    mapping = p;
+    mapping_size = st.st_size;
+    next = (const int*) (text + text_bytes);
+    end = next + h->payload_count;
+    return true;
+}
+
+int ProgramCache::ReadInt()
+{
+    if (next == end) {
+        failed = true;
+        return 0;
+    }
+    return *next++;
+}
+
+long long ProgramCache::ReadLong()
+{
+    unsigned low = ReadInt();
+    return (long long) ((unsigned long long) (unsigned) ReadInt() << 32 | low);
+}
+
+const int* ProgramCache::ReadInts(size_t n)
+{
+    if ((size_t) (end - next) < n) {
+        failed = true;
+        next = end;
+        return NULL;
+    }
+    const int* p = next;
+    next += n;
+    return p;
+}
+
+void ProgramCache::ReadVector(vector<int>& v)
+{
+    size_t n = (unsigned) ReadInt();
+    const int* p = ReadInts(n);
+    if (p)
+        v.assign(p, p + n);
+}
+
+void ProgramCache::WriteLong(long long v)
+{
+    WriteInt((int) (unsigned) v);
+    WriteInt((int) (unsigned) ((unsigned long long) v >> 32));
+}
+
+void ProgramCache::WriteVector(const vector<int>& v)
+{
+    WriteInt(v.size());
+    WriteInts(v.data(), v.size());
+}
+
+static bool WriteAll(int fd, const void* p, size_t n)
+{
+    const char* s = (const char*) p;
+    while (n > 0) {
+        ssize_t w = write(fd, s, n);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            return false;
+        s += w;
+        n -= w;
+    }
+    return true;
+}
+
+bool ProgramCache::Commit()
+{
+    if (prefix_length == NO_PREFIX)
+        return false;
+    Header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = PROGRAM_CACHE_MAGIC;
+    h.version = PROGRAM_CACHE_VERSION;
+    h.flags = flags;
+    h.prefix_length = prefix_length;
+    h.hash = hash;
+    h.payload_count = payload.size();
+    h.checksum = HashBytes((const char*) payload.data(), payload.size() * sizeof(int));
+
+    // unique per process and per entry, so parallel writers never share one
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%d.%p", (int) getpid(), (void*) this);
+    string temp = path + suffix;
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    static const char zeros[8] = { 0 };
+    bool ok = WriteAll(fd, &h, sizeof(h)) && WriteAll(fd, prefix.data(), prefix_length) &&
+              WriteAll(fd, zeros, PaddedLength(prefix_length) - prefix_length) &&
+              WriteAll(fd, payload.data(), payload.size() * sizeof(int));
+    ok = close(fd) == 0 && ok;
+    if (ok)
+        ok = rename(temp.c_str(), path.c_str()) == 0;
+    if (!ok)
+        unlink(temp.c_str());
+    return ok;
+}
@@ -0,0 +1,70 @@
+#ifndef __PROGCACHE__H__
+#define __PROGCACHE__H__
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// ProgramCache keeps compiled programs in a directory, one file per
+// program and set of flags, named after both and a hash of its source text
+// up to the INPUTS keyword.
+// A file is a small header, that text, and a flat stream of ints that the
+// parser writes and reads back in the same order. Open() only accepts an
+// entry whose text matches the source byte for byte, so programs whose
+// hashes collide never load each other's entry. Open() maps an entry
+// read-only, and arrays can be used straight from the mapping, so it must
+// outlive anything that points into it. New entries are written to a
+// temporary file and renamed into place, so concurrent runs never see a
+// partial one. The header carries a checksum of the payload, and Open()
+// treats an entry whose payload does not match it as a miss.
+class ProgramCache {
+  public:
+    // source is the whole program; flags are the options the compiled form
+    // depends on, which become part of the key
+    ProgramCache(const std::string& dir, const char* source, size_t len, unsigned flags);
+    ~ProgramCache();
+
+    // bytes before the INPUTS keyword, or NO_PREFIX if no INPUTS was found
+    size_t PrefixLength() const { return prefix_length; }
+    static const size_t NO_PREFIX = (size_t) -1;
+
+    // maps the entry for this source; false if there is none or it does not
+    // match the source
+    bool Open();
+    // Reading from the opened entry. Reading past its end sets Failed() and
+    // returns zeros.
+    int ReadInt();
+    long long ReadLong();
+    const int* ReadInts(size_t n);      // points into the mapping
+    void ReadVector(std::vector<int>& v);
+    bool Failed() const { return failed; }
+    // ints left to read
+    size_t Remaining() const { return end - next; }
+
+    // Collects a new entry for this source, written by Commit()
+    void WriteInt(int v) { payload.push_back(v); }
+    void WriteLong(long long v);
+    void WriteInts(const int* p, size_t n) { payload.insert(payload.end(), p, p + n); }
+    void WriteVector(const std::vector<int>& v);
+    bool Commit();
+
+  private:
+    ProgramCache(const ProgramCache&);
+    ProgramCache& operator=(const ProgramCache&);
+
+    std::string path;
+    size_t prefix_length;
+    std::string prefix;         // the source up to INPUTS
+    unsigned long long hash;
+    unsigned flags;
+
+    void* mapping;
+    size_t mapping_size;
+    const int* next;
+    const int* end;
+    bool failed;
+
+    std::vector<int> payload;
+};
+
+#endif  //__PROGCACHE__H__
@@ -0,0 +1,67 @@
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+#include "slotalloc.h"
+
+using namespace std;
+
+// An instruction i reads at position 2i+1 and writes at 2i+2; position 0
+// is the start of the program.
+SlotAllocator::SlotAllocator(int var_count)
+    : start(var_count, -1), end(var_count, -1)
+{
+}
+
+void SlotAllocator::Read(int var, int instruction)
+{
+    if (start[var] < 0)
+        start[var] = 0;
+    end[var] = 2 * instruction + 1;
+}
+
+void SlotAllocator::Write(int var, int instruction)
+{
+    if (start[var] < 0)
+        start[var] = 2 * instruction + 2;
+    end[var] = 2 * instruction + 2;
+}
+
+// Linear scan over the live ranges in order of their start: a slot is
+// reused once the range that held it has ended.
+int SlotAllocator::Allocate(vector<int>& slot)
+{
+    int var_count = start.size();
+    vector<int> order;
+    order.reserve(var_count);
+    for (int v = 0; v < var_count; v++) {
+        if (start[v] >= 0)  // a variable that is never accessed gets no slot
+            order.push_back(v);
+    }
+    // variables are numbered as they are first met, so this is nearly sorted
+    stable_sort(order.begin(), order.end(),
+                [this](int a, int b) { return start[a] < start[b]; });
+
+    typedef pair<int, int> Active;      // end of range, slot
+    priority_queue<Active, vector<Active>, greater<Active> > active;
+    vector<int> free_slots;
+    int slot_count = 0;
+
+    slot.assign(var_count, -1);
+    for (size_t i = 0; i < order.size(); i++) {
+        int v = order[i];
+        while (!active.empty() && active.top().first < start[v]) {
+            free_slots.push_back(active.top().second);
+            active.pop();
+        }
+        if (start[v] > 0 && !free_slots.empty()) {
+            slot[v] = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot[v] = slot_count++;
+        }
+        active.push(Active(end[v], slot[v]));
+    }
+    return slot_count;
+}
@@ -0,0 +1,34 @@
+#ifndef __SLOT_ALLOC__H__
+#define __SLOT_ALLOC__H__
+
+#include <vector>
+
+// SlotAllocator maps the variables of a program onto memory slots. The
+// parser numbers variables densely as it meets them; the allocator is then
+// told at which positions each one is read and written and gives two
+// variables the same slot when their live ranges do not overlap.
+//
+// Positions must be given in program order. Within one instruction the
+// reads come before the write, so an instruction's target can take over the
+// slot of an argument it reads for the last time. A variable that is read
+// before it is first written must read 0, so its range starts at the
+// beginning of the program and its slot is never handed down from another
+// variable.
+class SlotAllocator {
+  public:
+    explicit SlotAllocator(int var_count);
+
+    void Read(int var, int instruction);
+    void Write(int var, int instruction);
+
+    // Fills slot[var] for every variable and returns the number of slots.
+    // A variable that is never read or written, such as one whose
+    // instructions dead-store elimination dropped, gets slot -1.
+    int Allocate(std::vector<int>& slot);
+
+  private:
+    std::vector<int> start;     // first position where the variable is live
+    std::vector<int> end;       // last position where it is accessed
+};
+
+#endif  //__SLOT_ALLOC__H__
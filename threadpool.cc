@@ -0,0 +1,63 @@
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+#include "threadpool.h"
+
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(int thread_count) : thread_count(thread_count)
+{
+    if (this->thread_count <= 0)
+        this->thread_count = max(1u, thread::hardware_concurrency());
+    queues = vector<Queue>(this->thread_count);
+}
+
+// Jobs are never added while the pool runs, so a worker that finds every
+// queue empty can stop.
+bool WorkStealingPool::Take(int worker, size_t& job)
+{
+    {
+        Queue& own = queues[worker];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (int i = 1; i < thread_count; i++) {
+        Queue& victim = queues[(worker + i) % thread_count];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Work(int worker, const function<void(size_t)>& job)
+{
+    size_t next;
+    while (Take(worker, next))
+        job(next);
+}
+
+void WorkStealingPool::Run(size_t count, const function<void(size_t)>& job)
+{
+    // Each queue is filled in reverse, so its owner runs its jobs in
+    // submission order and thieves take the latest ones.
+    for (size_t i = count; i-- > 0; )
+        queues[i % thread_count].jobs.push_back(i);
+
+    vector<thread> threads;
+    for (int worker = 1; worker < thread_count; worker++)
+        threads.push_back(thread(&WorkStealingPool::Work, this, worker, cref(job)));
+    Work(0, job);
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
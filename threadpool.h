@@ -0,0 +1,42 @@
+#ifndef __THREADPOOL__H__
+#define __THREADPOOL__H__
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <cstddef>
+
+// WorkStealingPool runs a fixed set of independent jobs on a number of
+// threads. The jobs are dealt out to per-thread queues up front. Each
+// thread takes its own jobs from the back of its queue and, once that is
+// empty, steals from the front of the others', so a thread that drew short
+// jobs helps with the long ones instead of sitting idle.
+class WorkStealingPool {
+  public:
+    // thread_count <= 0 uses one thread per hardware thread
+    explicit WorkStealingPool(int thread_count = 0);
+
+    // Runs job(0) .. job(count-1) and returns when they have all finished.
+    // The calling thread is one of the workers.
+    void Run(size_t count, const std::function<void(size_t)>& job);
+
+    int ThreadCount() const { return thread_count; }
+
+  private:
+    WorkStealingPool(const WorkStealingPool&);
+    WorkStealingPool& operator=(const WorkStealingPool&);
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+
+    bool Take(int worker, size_t& job);
+    void Work(int worker, const std::function<void(size_t)>& job);
+
+    int thread_count;
+    std::vector<Queue> queues;
+};
+
+#endif  //__THREADPOOL__H__
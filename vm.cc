@@ -0,0 +1,174 @@
+#include <vector>
+#include <algorithm>
+
+#include "vm.h"
+
+using namespace std;
+
+#if defined(__GNUC__) && !defined(VM_SWITCH_DISPATCH)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+void Bytecode::Input(int slot)
+{
+    code.push_back(OP_INPUT);
+    code.push_back(slot);
+    instruction_count++;
+    input_count++;
+}
+
+void Bytecode::Output(int slot)
+{
+    code.push_back(OP_OUTPUT);
+    code.push_back(slot);
+    instruction_count++;
+}
+
+void Bytecode::Const(int slot, int value)
+{
+    code.push_back(OP_CONST);
+    code.push_back(slot);
+    code.push_back(value);
+    instruction_count++;
+}
+
+void Bytecode::Eval(int poly_id, int target, const vector<int>& args)
+{
+    code.push_back(OP_EVAL);
+    code.push_back(poly_id);
+    code.push_back(target);
+    code.push_back(args.size());
+    code.insert(code.end(), args.begin(), args.end());
+    instruction_count++;
+}
+
+void Bytecode::Halt()
+{
+    code.push_back(OP_HALT);
+}
+
+void Bytecode::Assign(const int* code, size_t size, long instruction_count, long input_count)
+{
+    this->code.assign(code, code + size);
+    this->instruction_count = instruction_count;
+    this->input_count = input_count;
+}
+
+VirtualMachine::VirtualMachine(const vector<const CompiledPolynomial*>& polys,
+                               JitCompiler* jit, long jit_threshold, bool memoize)
+    : polys(polys), jit(jit), native(polys.size(), (JitFunction) NULL),
+      countdown(polys.size(), jit ? jit_threshold + 1 : 0)
+{
+    size_t size = 0;
+    int arity = 0;
+    for (size_t i = 0; i < polys.size(); i++) {
+        table.push_back(size);
+        size += polys[i]->scratch_size;
+        arity = max(arity, polys[i]->param_count);
+        if (memoize)
+            memo.push_back(MemoCache(polys[i]->param_count));
+    }
+    key.resize(arity + 1);
+    scratch.resize(size + 1);
+    for (size_t i = 0; i < polys.size(); i++)
+        PrepareScratch(*polys[i], &scratch[table[i]]);
+}
+
+static inline int CallNative(JitFunction fn, const int* mem, const int* arg_slots, int argc)
+{
+    int a[JIT_MAX_PARAMS] = { 0 };
+    if (argc > JIT_MAX_PARAMS)
+        argc = JIT_MAX_PARAMS;
+    for (int i = 0; i < argc; i++)
+        a[i] = mem[arg_slots[i]];
+    return fn(a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+// OP_EVAL through the cache of the polynomial. The key is the argument
+// values the polynomial reads, with missing arguments as 0.
+int VirtualMachine::EvaluateMemoized(const int* pc, const int* mem)
+{
+    int id = pc[1];
+    int argc = pc[3];
+    const CompiledPolynomial& p = *polys[id];
+    for (int i = 0; i < p.param_count; i++)
+        key[i] = i < argc ? mem[pc[4 + i]] : 0;
+
+    int value;
+    if (memo[id].Lookup(key.data(), value))
+        return value;
+    if (native[id])
+        value = CallNative(native[id], mem, pc + 4, argc);
+    else
+        value = EvaluateGathered(p, mem, pc + 4, argc, &scratch[table[id]]);
+    memo[id].Insert(key.data(), value);
+    return value;
+}
+
+// Every evaluation counts toward compiling the polynomial, whether or not
+// its cache then answers it, so the polynomial is compiled after the same
+// number of evaluations with and without --memo.
+int VirtualMachine::Evaluate(const int* pc, const int* mem)
+{
+    int id = pc[1];
+    if (native[id] == NULL && countdown[id] > 0 && --countdown[id] == 0)
+        native[id] = jit->Compile(*polys[id]);
+    if (!memo.empty() && memo[id].Enabled())
+        return EvaluateMemoized(pc, mem);
+    if (native[id])
+        return CallNative(native[id], mem, pc + 4, pc[3]);
+    return EvaluateGathered(*polys[id], mem, pc + 4, pc[3], &scratch[table[id]]);
+}
+
+void VirtualMachine::Run(const Bytecode& bytecode, int* mem, const vector<int>& inputs, OutputSink& out)
+{
+    const int* pc = bytecode.Code();
+    const int* input = inputs.data();
+    const int* input_end = input + inputs.size();
+
+#if VM_THREADED
+    static const void* const labels[OP_COUNT] = {
+        &&L_OP_INPUT, &&L_OP_OUTPUT, &&L_OP_CONST, &&L_OP_EVAL, &&L_OP_HALT
+    };
+#define VM_TARGET(op)   L_##op:
+#define VM_NEXT()       goto *labels[*pc]
+    VM_NEXT();
+#else
+#define VM_TARGET(op)   case op:
+#define VM_NEXT()       continue
+    for (;;) switch (*pc) {
+#endif
+
+    VM_TARGET(OP_INPUT)
+        mem[pc[1]] = input < input_end ? *input++ : 0;
+        pc += 2;
+        VM_NEXT();
+
+    VM_TARGET(OP_OUTPUT)
+        out << mem[pc[1]] << '\n';
+        pc += 2;
+        VM_NEXT();
+
+    VM_TARGET(OP_CONST)
+        mem[pc[1]] = pc[2];
+        pc += 3;
+        VM_NEXT();
+
+    VM_TARGET(OP_EVAL)
+        mem[pc[2]] = Evaluate(pc, mem);
+        pc += 4 + pc[3];
+        VM_NEXT();
+
+    VM_TARGET(OP_HALT)
+        return;
+
+#if !VM_THREADED
+    default:
+        return;
+    }
+#endif
+#undef VM_TARGET
+#undef VM_NEXT
+}
@@ -0,0 +1,90 @@
+#ifndef __VM__H__
+#define __VM__H__
+
+#include <vector>
+
+#include "poly.h"
+#include "jit.h"
+#include "memo.h"
+#include "outsink.h"
+
+// Opcodes of the EXECUTE bytecode. Operands follow the opcode in the code
+// stream as ints:
+//   OP_INPUT  slot                       mem[slot] = next input
+//   OP_OUTPUT slot                       print mem[slot]
+//   OP_CONST  slot value                 mem[slot] = value
+//   OP_EVAL   poly target argc arg...    mem[target] = poly(mem[arg]...)
+//   OP_HALT
+enum Opcode {
+    OP_INPUT,
+    OP_OUTPUT,
+    OP_CONST,
+    OP_EVAL,
+    OP_HALT,
+    OP_COUNT
+};
+
+// Bytecode is the EXECUTE section compiled to a flat int stream with
+// memory slots already resolved
+class Bytecode {
+  public:
+    Bytecode() : instruction_count(0), input_count(0) {}
+
+    void Input(int slot);
+    void Output(int slot);
+    void Const(int slot, int value);
+    void Eval(int poly_id, int target, const std::vector<int>& args);
+    void Halt();
+    // replaces the code with a copy of size ints compiled earlier
+    void Assign(const int* code, size_t size, long instruction_count, long input_count);
+
+    const int* Code() const { return code.data(); }
+    size_t Size() const { return code.size(); }
+    // the section has no branches, so this is also the number executed
+    long InstructionCount() const { return instruction_count; }
+    // number of values one run reads
+    long InputCount() const { return input_count; }
+
+  private:
+    std::vector<int> code;
+    long instruction_count;
+    long input_count;
+};
+
+// VirtualMachine runs Bytecode over a memory image. Dispatch is threaded
+// through computed gotos with GCC and clang; other compilers, or building
+// with -DVM_SWITCH_DISPATCH, get a switch loop.
+class VirtualMachine {
+  public:
+    // polys[i] is the compiled polynomial with id i. With a JitCompiler, a
+    // polynomial evaluated more than jit_threshold times is compiled to
+    // native code and called directly from then on. With memoize, each
+    // polynomial gets a MemoCache of its results.
+    explicit VirtualMachine(const std::vector<const CompiledPolynomial*>& polys,
+                            JitCompiler* jit = NULL, long jit_threshold = 0,
+                            bool memoize = false);
+
+    // Inputs past the end of inputs read as 0
+    void Run(const Bytecode& bytecode, int* mem, const std::vector<int>& inputs, OutputSink& out);
+
+    // Evaluates the OP_EVAL instruction at pc the way Run() does and returns
+    // its value, leaving mem untouched
+    int Evaluate(const int* pc, const int* mem);
+
+    // the result cache of polynomial i, NULL without memoize
+    const MemoCache* Memo(int i) const { return memo.empty() ? NULL : &memo[i]; }
+
+  private:
+    int EvaluateMemoized(const int* pc, const int* mem);
+
+    std::vector<const CompiledPolynomial*> polys;
+    std::vector<unsigned> scratch;      // the evaluation tables of all polynomials
+    std::vector<size_t> table;          // offset of the table of each polynomial
+    JitCompiler* jit;
+    std::vector<JitFunction> native;    // NULL until compiled
+    std::vector<long> countdown;        // evaluations left before compiling, 0 once tried
+    std::vector<MemoCache> memo;        // empty unless memoizing
+    std::vector<int> key;               // argument tuple being looked up
+};
+
+#endif  //__VM__H__